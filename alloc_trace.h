@@ -0,0 +1,46 @@
+// alloc_trace.h
+#ifndef ALLOC_TRACE_H
+#define ALLOC_TRACE_H
+
+// Binary allocation trace written by the cM2.c interposer (CM2_TRACE=path)
+// and read by replay_trace. A file is one alloc_trace_header followed by
+// alloc_trace_record entries in the order they were written.
+
+#include <stdint.h>
+
+#define ALLOC_TRACE_MAGIC 0x43525441u  // "ATRC" little endian
+#define ALLOC_TRACE_VERSION 1
+
+/// Calls a record describes
+typedef enum {
+    ALLOC_TRACE_MALLOC = 1,
+    ALLOC_TRACE_FREE,
+    ALLOC_TRACE_REALLOC,
+    ALLOC_TRACE_CALLOC,
+    ALLOC_TRACE_MEMALIGN
+} alloc_trace_op;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;  // sizeof(alloc_trace_record) of the writer
+} alloc_trace_header;
+
+/// One call. Blocks are identified by address: an address names the same
+/// block from the call that returned it until the call that released it.
+/// Releases (free, the old block of realloc) happen at start_ns, the block
+/// a call returns exists from start_ns + duration_ns, which orders address
+/// reuse across threads even though records from different threads may be
+/// written out of order.
+typedef struct {
+    uint64_t start_ns;     // CLOCK_MONOTONIC when the call was entered
+    uint64_t size;         // bytes requested, nmemb * size for calloc
+    uint64_t id;           // block returned, or freed for free; 0 if none
+    uint64_t old_id;       // block passed to realloc, 0 otherwise
+    uint32_t thread;       // 1, 2, ... in order of each thread's first call
+    uint32_t duration_ns;  // time spent in the call, saturates
+    uint8_t op;            // alloc_trace_op
+    uint8_t pad[7];
+} alloc_trace_record;
+
+#endif  // ALLOC_TRACE_H
@@ -0,0 +1,251 @@
+// bench_common.h
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+// Shared helpers of the bench_* programs: wall clock timing, random inputs,
+// zipfian ranks, resident memory, latency percentiles and CSV/JSON rows
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/// @brief Monotonic wall clock in nanoseconds
+static inline uint64_t bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+/// xorshift64* generator, one per thread so that inputs cost no shared state
+typedef struct {
+    uint64_t state;
+} bench_rng;
+
+static inline void bench_rng_seed(bench_rng *rng, uint64_t seed) {
+    rng->state = seed * 0x9e3779b97f4a7c15ULL + 1;
+}
+
+static inline uint64_t bench_rng_next(bench_rng *rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545f4914f6cdd1dULL;
+}
+
+/// @brief Uniform double in (0, 1]
+static inline double bench_rng_unit(bench_rng *rng) {
+    return ((bench_rng_next(rng) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/// Distributions request sizes are drawn from
+typedef enum {
+    BENCH_SIZE_FIXED,     // always the minimum
+    BENCH_SIZE_UNIFORM,   // uniform between minimum and maximum
+    BENCH_SIZE_POWER_LAW  // Pareto with shape 1, mostly small with a long tail
+} bench_size_dist;
+
+static inline const char *bench_size_dist_name(bench_size_dist dist) {
+    switch (dist) {
+        case BENCH_SIZE_UNIFORM:
+            return "uniform";
+        case BENCH_SIZE_POWER_LAW:
+            return "power_law";
+        default:
+            return "fixed";
+    }
+}
+
+/// @brief Draws a size between @p min and @p max from @p dist
+static inline size_t bench_size(bench_size_dist dist, bench_rng *rng,
+                                size_t min, size_t max) {
+    switch (dist) {
+        case BENCH_SIZE_UNIFORM:
+            return min + bench_rng_next(rng) % (max - min + 1);
+        case BENCH_SIZE_POWER_LAW: {
+            double size = min / bench_rng_unit(rng);
+            return size > max ? max : (size_t)size;
+        }
+        default:
+            return min;
+    }
+}
+
+/// @brief Resident set size of the process in bytes, 0 if unknown
+static inline size_t bench_rss_bytes(void) {
+    unsigned long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    if (fscanf(statm, "%lu %lu", &pages, &resident) != 2) resident = 0;
+    fclose(statm);
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/// Zipfian ranks over [0, n) after Gray et al., "Quickly generating
+/// billion-record synthetic databases", the generator YCSB uses. Rank 0 is
+/// the most popular.
+typedef struct {
+    uint64_t n;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+} bench_zipf;
+
+/// @brief Prepares ranks over [0, @p n) with skew @p theta (0 < theta < 1,
+/// YCSB uses 0.99). Costs O(n) once.
+static inline void bench_zipf_init(bench_zipf *zipf, uint64_t n, double theta) {
+    double zeta2 = 1.0 + pow(0.5, theta);
+    zipf->n = n;
+    zipf->theta = theta;
+    zipf->zetan = 0;
+    for (uint64_t i = 1; i <= n; i++) zipf->zetan += 1.0 / pow((double)i, theta);
+    zipf->alpha = 1.0 / (1.0 - theta);
+    zipf->eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zipf->zetan);
+}
+
+/// @brief Draws a rank, cheap and safe to call from many threads
+static inline uint64_t bench_zipf_next(const bench_zipf *zipf, bench_rng *rng) {
+    double u = bench_rng_unit(rng);
+    double uz = u * zipf->zetan;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + pow(0.5, zipf->theta)) return 1;
+    uint64_t rank =
+        (uint64_t)(zipf->n * pow(zipf->eta * u - zipf->eta + 1.0, zipf->alpha));
+    return rank < zipf->n ? rank : zipf->n - 1;
+}
+
+/// Latency samples of one kind of operation, in nanoseconds
+typedef struct {
+    uint64_t *ns;
+    size_t count;
+    size_t capacity;
+} bench_samples;
+
+static inline void bench_samples_init(bench_samples *samples, size_t capacity) {
+    samples->ns = malloc(capacity * sizeof(uint64_t));
+    samples->count = 0;
+    samples->capacity = samples->ns ? capacity : 0;
+    // Fault the pages in now rather than inside a timed operation
+    if (samples->ns) memset(samples->ns, 0, capacity * sizeof(uint64_t));
+}
+
+/// @brief Records one sample, samples past the capacity are dropped
+static inline void bench_record(bench_samples *samples, uint64_t ns) {
+    if (samples->count < samples->capacity) samples->ns[samples->count++] = ns;
+}
+
+/// @brief Appends the samples of @p from to @p into
+static inline void bench_samples_merge(bench_samples *into,
+                                       const bench_samples *from) {
+    if (into->count + from->count > into->capacity) {
+        size_t capacity = into->count + from->count;
+        uint64_t *grown = realloc(into->ns, capacity * sizeof(uint64_t));
+        if (!grown) return;
+        into->ns = grown;
+        into->capacity = capacity;
+    }
+    memcpy(into->ns + into->count, from->ns, from->count * sizeof(uint64_t));
+    into->count += from->count;
+}
+
+static inline void bench_samples_free(bench_samples *samples) {
+    free(samples->ns);
+    samples->ns = NULL;
+    samples->count = samples->capacity = 0;
+}
+
+static int bench_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/// @brief Nearest-rank percentile @p p (0..100) of @p samples, sorts them
+static inline uint64_t bench_percentile(bench_samples *samples, double p) {
+    if (samples->count == 0) return 0;
+    qsort(samples->ns, samples->count, sizeof(uint64_t), bench_compare_u64);
+    size_t rank = (size_t)ceil(p / 100.0 * samples->count);
+    return samples->ns[rank ? rank - 1 : 0];
+}
+
+/// Output formats of the result rows
+typedef enum { BENCH_CSV, BENCH_JSON } bench_format;
+
+/// @brief Parses "csv" or "json"
+/// @return 0, or -1 for anything else
+static inline int bench_parse_format(const char *name, bench_format *format) {
+    if (strcmp(name, "csv") == 0)
+        *format = BENCH_CSV;
+    else if (strcmp(name, "json") == 0)
+        *format = BENCH_JSON;
+    else
+        return -1;
+    return 0;
+}
+
+/// One result row, keys name what was measured and the numbers what came out
+typedef struct {
+    const char *bench;      // program or workload family
+    const char *workload;   // e.g. the size distribution or the op mix
+    const char *op;         // operation the latencies belong to, "all" for
+                            // the whole run
+    int threads;
+    size_t ops;             // operations timed
+    double seconds;         // wall time of the run
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    size_t failures;        // operations that could not be carried out
+    size_t rss_kb;          // resident memory the run added, 0 if not taken
+    double frag;            // share of that memory not holding live data
+    double relative;        // throughput relative to a baseline row, 0 if none
+} bench_row;
+
+/// @brief Fills the latency percentiles of @p row from @p samples
+static inline void bench_row_latencies(bench_row *row, bench_samples *samples) {
+    row->p50_ns = bench_percentile(samples, 50);
+    row->p99_ns = bench_percentile(samples, 99);
+    row->p999_ns = bench_percentile(samples, 99.9);
+}
+
+/// @brief Prints the CSV header, JSON rows need none
+static inline void bench_print_header(FILE *out, bench_format format) {
+    if (format == BENCH_CSV)
+        fprintf(out,
+                "bench,workload,op,threads,ops,seconds,ops_per_sec,p50_ns,"
+                "p99_ns,p999_ns,failures,rss_kb,frag,relative\n");
+}
+
+/// @brief Prints @p row as a CSV line or as one JSON object per line
+static inline void bench_print_row(FILE *out, bench_format format,
+                                   const bench_row *row) {
+    double rate = row->seconds > 0 ? row->ops / row->seconds : 0;
+    if (format == BENCH_CSV) {
+        fprintf(out,
+                "%s,%s,%s,%d,%zu,%.6f,%.0f,%llu,%llu,%llu,%zu,%zu,%.3f,%.3f\n",
+                row->bench, row->workload, row->op, row->threads, row->ops,
+                row->seconds, rate, (unsigned long long)row->p50_ns,
+                (unsigned long long)row->p99_ns,
+                (unsigned long long)row->p999_ns, row->failures, row->rss_kb,
+                row->frag, row->relative);
+    } else {
+        fprintf(out,
+                "{\"bench\": \"%s\", \"workload\": \"%s\", \"op\": \"%s\", "
+                "\"threads\": %d, \"ops\": %zu, \"seconds\": %.6f, "
+                "\"ops_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+                "\"p999_ns\": %llu, \"failures\": %zu, \"rss_kb\": %zu, "
+                "\"frag\": %.3f, \"relative\": %.3f}\n",
+                row->bench, row->workload, row->op, row->threads, row->ops,
+                row->seconds, rate, (unsigned long long)row->p50_ns,
+                (unsigned long long)row->p99_ns,
+                (unsigned long long)row->p999_ns, row->failures, row->rss_kb,
+                row->frag, row->relative);
+    }
+    fflush(out);
+}
+
+#endif  // BENCH_COMMON_H
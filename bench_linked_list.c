@@ -0,0 +1,264 @@
+// bench_linked_list.c
+// YCSB-style read/write mixes against a shared List: each operation is a
+// search, or an insert or delete split evenly, on a key drawn uniformly or
+// zipfian over the uint16 space. Reports wall-clock throughput and latency
+// percentiles per thread count and sync mode as CSV (default) or JSON lines.
+//
+// usage: bench_linked_list [-f csv|json] [-n ops] [-w warmup] [-t threads]
+//                          [-p preload] [-r read%] [-m mode]
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench_common.h"
+#include "linked_list.h"
+
+#define KEY_SPACE 65536
+#define ZIPF_THETA 0.99
+#define NODE_BYTES 64  // pool bytes reserved per node, header included
+
+typedef enum { KEYS_UNIFORM, KEYS_ZIPFIAN } key_dist;
+
+enum { OP_SEARCH, OP_INSERT, OP_DELETE, OP_KINDS };
+static const char *op_names[OP_KINDS] = {"search", "insert", "delete"};
+
+static bench_zipf zipf;
+
+typedef struct {
+    int thread_id;
+    List *list;
+    size_t ops;
+    size_t warmup;
+    int read_percent;
+    key_dist keys;
+    pthread_barrier_t *start;
+    uint64_t begin_ns;  // wall clock span of the timed operations
+    uint64_t end_ns;
+    bench_samples samples[OP_KINDS];
+} bench_thread;
+
+/// @brief Draws a key. Zipfian ranks are scattered over the key space with an
+/// odd multiplier (a bijection mod 2^16) so hot keys are not all small.
+static uint16_t next_key(key_dist keys, bench_rng *rng) {
+    if (keys == KEYS_ZIPFIAN)
+        return (uint16_t)(bench_zipf_next(&zipf, rng) * 0x9e37u + 0x7f4au);
+    return (uint16_t)bench_rng_next(rng);
+}
+
+/// @brief Runs one operation of the mix
+/// @return the kind of operation that ran
+static int step(bench_thread *self, bench_rng *rng, uint64_t *elapsed) {
+    uint16_t key = next_key(self->keys, rng);
+    uint64_t roll = bench_rng_next(rng) % 100;
+    int op = roll < (uint64_t)self->read_percent ? OP_SEARCH
+             : roll & 1                          ? OP_INSERT
+                                                 : OP_DELETE;
+    uint64_t begin = bench_now_ns();
+    switch (op) {
+        case OP_SEARCH:
+            list_h_search(self->list, key);
+            break;
+        case OP_INSERT:
+            list_h_insert(self->list, key);
+            break;
+        default:
+            list_h_delete(self->list, key);
+            break;
+    }
+    *elapsed = bench_now_ns() - begin;
+    return op;
+}
+
+static void *bench_worker(void *arg) {
+    bench_thread *self = arg;
+    bench_rng rng;
+    uint64_t elapsed;
+    bench_rng_seed(&rng, self->thread_id + 1);
+
+    for (size_t i = 0; i < self->warmup; i++) step(self, &rng, &elapsed);
+    pthread_barrier_wait(self->start);
+
+    self->begin_ns = bench_now_ns();
+    for (size_t i = 0; i < self->ops; i++) {
+        int op = step(self, &rng, &elapsed);
+        bench_record(&self->samples[op], elapsed);
+    }
+    self->end_ns = bench_now_ns();
+    return NULL;
+}
+
+/// @brief Fills a fresh list with @p preload keys, runs @p threads workers on
+/// it and prints one row for the whole run and one per operation kind
+static void run(bench_format format, list_sync_mode mode, int read_percent,
+                key_dist keys, int threads, size_t preload, size_t ops,
+                size_t warmup) {
+    size_t nodes = preload + (size_t)threads * (ops + warmup) +
+                   LIST_RCU_RETIRE_BATCH;
+    List *list = aligned_alloc(64, sizeof(List));
+    list_h_init(list, nodes * NODE_BYTES, mode);
+
+    uint16_t *values = malloc(preload * sizeof(uint16_t));
+    bench_rng rng;
+    bench_rng_seed(&rng, 0);
+    for (size_t i = 0; i < preload; i++) values[i] = next_key(keys, &rng);
+    list_h_insert_bulk(list, values, preload);
+    free(values);
+
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    bench_thread *workers = calloc(threads, sizeof(bench_thread));
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, threads + 1);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (bench_thread){.thread_id = t,
+                                    .list = list,
+                                    .ops = ops,
+                                    .warmup = warmup,
+                                    .read_percent = read_percent,
+                                    .keys = keys,
+                                    .start = &start};
+        for (int op = 0; op < OP_KINDS; op++)
+            bench_samples_init(&workers[t].samples[op], ops);
+        pthread_create(&ids[t], NULL, bench_worker, &workers[t]);
+    }
+    pthread_barrier_wait(&start);
+    for (int t = 0; t < threads; t++) pthread_join(ids[t], NULL);
+    // Timed from the first worker starting to the last one finishing; the
+    // main thread may not run again until well after the barrier opens
+    uint64_t begin = workers[0].begin_ns, end = workers[0].end_ns;
+    for (int t = 1; t < threads; t++) {
+        if (workers[t].begin_ns < begin) begin = workers[t].begin_ns;
+        if (workers[t].end_ns > end) end = workers[t].end_ns;
+    }
+    double seconds = (end - begin) / 1e9;
+
+    bench_samples all, per_op[OP_KINDS];
+    bench_samples_init(&all, 0);
+    for (int op = 0; op < OP_KINDS; op++) {
+        bench_samples_init(&per_op[op], 0);
+        for (int t = 0; t < threads; t++) {
+            bench_samples_merge(&per_op[op], &workers[t].samples[op]);
+            bench_samples_merge(&all, &workers[t].samples[op]);
+        }
+    }
+
+    char workload[64];
+    snprintf(workload, sizeof(workload), "read%d/%s/%s", read_percent,
+             keys == KEYS_ZIPFIAN ? "zipfian" : "uniform", list_sync_name(mode));
+    bench_row row = {.bench = "linked_list",
+                     .workload = workload,
+                     .op = "all",
+                     .threads = threads,
+                     .ops = all.count,
+                     .seconds = seconds};
+    bench_row_latencies(&row, &all);
+    bench_print_row(stdout, format, &row);
+    for (int op = 0; op < OP_KINDS; op++) {
+        row.op = op_names[op];
+        row.ops = per_op[op].count;
+        bench_row_latencies(&row, &per_op[op]);
+        bench_print_row(stdout, format, &row);
+        bench_samples_free(&per_op[op]);
+    }
+    bench_samples_free(&all);
+
+    for (int t = 0; t < threads; t++)
+        for (int op = 0; op < OP_KINDS; op++)
+            bench_samples_free(&workers[t].samples[op]);
+    pthread_barrier_destroy(&start);
+    free(workers);
+    free(ids);
+    list_h_cleanup(list);
+    free(list);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-f csv|json] [-n ops] [-w warmup] [-t threads] "
+            "[-p preload] [-r read%%] [-m mode]\n"
+            "  -f  output format (default csv)\n"
+            "  -n  timed operations per thread (default 5000)\n"
+            "  -w  untimed warmup operations per thread (default 500)\n"
+            "  -t  largest thread count, runs 1, 2, 4, ... up to it (default 8)\n"
+            "  -p  keys in the list before the run (default 1000)\n"
+            "  -r  share of searches in percent, default runs 90 and 50\n"
+            "  -m  rwlock, rcu, ticket, adaptive or brlock, default runs all\n",
+            name);
+}
+
+int main(int argc, char *argv[]) {
+    bench_format format = BENCH_CSV;
+    size_t ops = 5000;
+    size_t warmup = 500;
+    size_t preload = 1000;
+    int max_threads = 8;
+    int mixes[] = {90, 50};
+    size_t mix_count = 2;
+    list_sync_mode modes[] = {LIST_SYNC_RWLOCK, LIST_SYNC_RCU, LIST_SYNC_TICKET,
+                              LIST_SYNC_ADAPTIVE, LIST_SYNC_BRLOCK};
+    size_t first_mode = 0, mode_count = 5;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:w:t:p:r:m:")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (bench_parse_format(optarg, &format) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                ops = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'p':
+                preload = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                mixes[0] = atoi(optarg);
+                mix_count = 1;
+                if (mixes[0] < 0 || mixes[0] > 100) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'm':
+                mode_count = 0;
+                for (size_t m = 0; m < 5; m++) {
+                    if (strcmp(optarg, list_sync_name(modes[m])) == 0) {
+                        first_mode = m;
+                        mode_count = 1;
+                    }
+                }
+                if (mode_count == 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (ops == 0 || max_threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_zipf_init(&zipf, KEY_SPACE, ZIPF_THETA);
+    bench_print_header(stdout, format);
+    key_dist dists[] = {KEYS_UNIFORM, KEYS_ZIPFIAN};
+    for (size_t m = first_mode; m < first_mode + mode_count; m++)
+        for (size_t mix = 0; mix < mix_count; mix++)
+            for (size_t d = 0; d < 2; d++)
+                for (int threads = 1; threads <= max_threads; threads *= 2)
+                    run(format, modes[m], mixes[mix], dists[d], threads,
+                        preload, ops, warmup);
+    return 0;
+}
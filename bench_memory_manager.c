@@ -0,0 +1,333 @@
+// bench_memory_manager.c
+// Throughput and latency percentiles of mem_alloc, mem_free and mem_resize
+// for several request size distributions and thread counts. Results go to
+// stdout as CSV (default) or JSON lines so runs on two commits can be diffed.
+//
+// With -c every workload also runs through malloc/free/realloc, which is
+// whatever allocator LD_PRELOAD put in front of the C library, so the rows
+// show when the pool pays off. Each row then carries the resident memory the
+// run added (rss_kb), the share of it not holding live requested bytes
+// (frag) and its throughput relative to the pool's (relative).
+//
+// usage: bench_memory_manager [-f csv|json] [-n ops] [-w warmup] [-t threads]
+//                             [-l mutex|ticket|adaptive] [-c]
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench_common.h"
+#include "memory_manager.h"
+
+#define LIVE_BLOCKS 64    // blocks each thread keeps allocated at most
+#define MIN_SIZE 16
+#define MAX_SIZE 4096
+#define RESIZE_PERCENT 25 // share of operations on a live block that resize it
+
+enum { OP_ALLOC, OP_FREE, OP_RESIZE, OP_KINDS };
+static const char *op_names[OP_KINDS] = {"alloc", "free", "resize"};
+
+/// Allocator the workload runs through
+typedef struct {
+    bool pool;  // the memory manager rather than malloc
+    void *(*alloc)(size_t size);
+    void (*free)(void *block);
+    void *(*resize)(void *block, size_t size);
+} backend;
+
+static const backend pool_backend = {true, mem_alloc, mem_free, mem_resize};
+static const backend malloc_backend = {false, malloc, free, realloc};
+
+typedef struct {
+    int thread_id;
+    const backend *backend;
+    size_t ops;
+    size_t warmup;
+    bench_size_dist dist;
+    pthread_barrier_t *ready;  // threads exist, passed twice around the setup
+    pthread_barrier_t *start;
+    pthread_barrier_t *peak;  // all threads done, blocks still live
+    uint64_t begin_ns;        // wall clock span of the timed operations
+    uint64_t end_ns;
+    size_t live_bytes;        // requested bytes live at the end of the run
+    bench_samples samples[OP_KINDS];
+    size_t failures;
+} bench_thread;
+
+/// @brief Runs one operation on a random slot: allocates it if empty,
+/// otherwise frees or resizes it
+/// @return the kind of operation that ran
+static int step(bench_thread *self, bench_rng *rng, void **live,
+                size_t *sizes, uint64_t *elapsed, bool *failed) {
+    const backend *with = self->backend;
+    size_t slot = bench_rng_next(rng) % LIVE_BLOCKS;
+    size_t size = bench_size(self->dist, rng, MIN_SIZE, MAX_SIZE);
+    uint64_t begin;
+    int op;
+    *failed = false;
+    if (!live[slot]) {
+        op = OP_ALLOC;
+        begin = bench_now_ns();
+        live[slot] = with->alloc(size);
+        *elapsed = bench_now_ns() - begin;
+        *failed = live[slot] == NULL;
+        sizes[slot] = live[slot] ? size : 0;
+    } else if (bench_rng_next(rng) % 100 < RESIZE_PERCENT) {
+        op = OP_RESIZE;
+        begin = bench_now_ns();
+        void *resized = with->resize(live[slot], size);
+        *elapsed = bench_now_ns() - begin;
+        if (resized) {
+            live[slot] = resized;
+            sizes[slot] = size;
+        } else {
+            *failed = true;
+        }
+    } else {
+        op = OP_FREE;
+        begin = bench_now_ns();
+        with->free(live[slot]);
+        *elapsed = bench_now_ns() - begin;
+        live[slot] = NULL;
+        sizes[slot] = 0;
+    }
+    return op;
+}
+
+static void *bench_worker(void *arg) {
+    bench_thread *self = arg;
+    void *live[LIVE_BLOCKS] = {NULL};
+    size_t sizes[LIVE_BLOCKS] = {0};
+    bench_rng rng;
+    uint64_t elapsed;
+    bool failed;
+    bench_rng_seed(&rng, self->thread_id + 1);
+
+    pthread_barrier_wait(self->ready);
+    pthread_barrier_wait(self->ready);
+    for (size_t i = 0; i < self->warmup; i++)
+        step(self, &rng, live, sizes, &elapsed, &failed);
+    pthread_barrier_wait(self->start);
+
+    self->begin_ns = bench_now_ns();
+    for (size_t i = 0; i < self->ops; i++) {
+        int op = step(self, &rng, live, sizes, &elapsed, &failed);
+        bench_record(&self->samples[op], elapsed);
+        self->failures += failed;
+    }
+    self->end_ns = bench_now_ns();
+
+    for (size_t i = 0; i < LIVE_BLOCKS; i++) self->live_bytes += sizes[i];
+    pthread_barrier_wait(self->peak);
+    for (size_t i = 0; i < LIVE_BLOCKS; i++)
+        if (live[i]) self->backend->free(live[i]);
+    return NULL;
+}
+
+/// @brief Runs @p threads workers through @p with and prints one row for the
+/// whole run and one per operation kind
+/// @param baseline ops/sec of the pool per row ("all" first), filled in when
+/// @p with is the pool and used for the relative column otherwise, may be
+/// NULL
+static void run(bench_format format, const backend *with, mem_lock_kind lock,
+                bench_size_dist dist, int threads, size_t ops, size_t warmup,
+                double *baseline) {
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    bench_thread *workers = calloc(threads, sizeof(bench_thread));
+    pthread_barrier_t ready, start, peak;
+    pthread_barrier_init(&ready, NULL, threads + 1);
+    pthread_barrier_init(&start, NULL, threads + 1);
+    pthread_barrier_init(&peak, NULL, threads + 1);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (bench_thread){.thread_id = t,
+                                    .backend = with,
+                                    .ops = ops,
+                                    .warmup = warmup,
+                                    .dist = dist,
+                                    .ready = &ready,
+                                    .start = &start,
+                                    .peak = &peak};
+        for (int op = 0; op < OP_KINDS; op++)
+            bench_samples_init(&workers[t].samples[op], ops);
+    }
+
+    for (int t = 0; t < threads; t++)
+        pthread_create(&ids[t], NULL, bench_worker, &workers[t]);
+    // Threads and samples are resident by now, so what the run adds on top
+    // is the allocator's footprint
+    pthread_barrier_wait(&ready);
+    size_t rss_before = bench_rss_bytes();
+    if (with->pool)
+        // Room for every live block at its largest plus the block headers
+        mem_init_lock((size_t)threads * LIVE_BLOCKS * (MAX_SIZE + 64) * 2,
+                      lock);
+    pthread_barrier_wait(&ready);
+    pthread_barrier_wait(&start);
+    pthread_barrier_wait(&peak);
+    size_t rss_peak = bench_rss_bytes();
+    for (int t = 0; t < threads; t++) pthread_join(ids[t], NULL);
+    // Timed from the first worker starting to the last one finishing; the
+    // main thread may not run again until well after the barrier opens
+    uint64_t begin = workers[0].begin_ns, end = workers[0].end_ns;
+    for (int t = 1; t < threads; t++) {
+        if (workers[t].begin_ns < begin) begin = workers[t].begin_ns;
+        if (workers[t].end_ns > end) end = workers[t].end_ns;
+    }
+    double seconds = (end - begin) / 1e9;
+
+    bench_samples all, per_op[OP_KINDS];
+    bench_samples_init(&all, 0);
+    size_t failures = 0, live_bytes = 0;
+    for (int op = 0; op < OP_KINDS; op++) {
+        bench_samples_init(&per_op[op], 0);
+        for (int t = 0; t < threads; t++) {
+            bench_samples_merge(&per_op[op], &workers[t].samples[op]);
+            bench_samples_merge(&all, &workers[t].samples[op]);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        failures += workers[t].failures;
+        live_bytes += workers[t].live_bytes;
+    }
+    size_t footprint = rss_peak > rss_before ? rss_peak - rss_before : 0;
+
+    char workload[64];
+    snprintf(workload, sizeof(workload), "%s/%s", bench_size_dist_name(dist),
+             with->pool ? mem_lock_name(lock) : "malloc");
+    bench_row row = {.bench = "memory_manager",
+                     .workload = workload,
+                     .op = "all",
+                     .threads = threads,
+                     .ops = all.count,
+                     .seconds = seconds,
+                     .failures = failures};
+    if (baseline) {
+        row.rss_kb = footprint / 1024;
+        row.frag = footprint > live_bytes
+                       ? 1.0 - (double)live_bytes / footprint
+                       : 0;
+    }
+    for (int op = -1; op < OP_KINDS; op++) {
+        bench_samples *samples = op < 0 ? &all : &per_op[op];
+        if (op >= 0) {
+            row.op = op_names[op];
+            row.ops = samples->count;
+            row.failures = 0;
+        }
+        if (baseline) {
+            double rate = seconds > 0 ? row.ops / seconds : 0;
+            if (with->pool) baseline[op + 1] = rate;
+            row.relative = baseline[op + 1] > 0 ? rate / baseline[op + 1] : 0;
+        }
+        bench_row_latencies(&row, samples);
+        bench_print_row(stdout, format, &row);
+    }
+    for (int op = 0; op < OP_KINDS; op++) bench_samples_free(&per_op[op]);
+    bench_samples_free(&all);
+
+    for (int t = 0; t < threads; t++)
+        for (int op = 0; op < OP_KINDS; op++)
+            bench_samples_free(&workers[t].samples[op]);
+    pthread_barrier_destroy(&ready);
+    pthread_barrier_destroy(&start);
+    pthread_barrier_destroy(&peak);
+    free(workers);
+    free(ids);
+    if (with->pool)
+        mem_deinit();
+    else
+        // Hand freed arena memory back so the next run starts from the same
+        // footprint (a no-op for allocators other than glibc's)
+        malloc_trim(0);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-f csv|json] [-n ops] [-w warmup] [-t threads] "
+            "[-l mutex|ticket|adaptive] [-c]\n"
+            "  -f  output format (default csv)\n"
+            "  -n  timed operations per thread (default 20000)\n"
+            "  -w  untimed warmup operations per thread (default 2000)\n"
+            "  -t  largest thread count, runs 1, 2, 4, ... up to it (default 8)\n"
+            "  -l  allocation lock of the pool (default mutex)\n"
+            "  -c  also run every workload through malloc and compare\n",
+            name);
+}
+
+int main(int argc, char *argv[]) {
+    bench_format format = BENCH_CSV;
+    size_t ops = 20000;
+    size_t warmup = 2000;
+    int max_threads = 8;
+    mem_lock_kind lock = MEM_LOCK_MUTEX;
+    bool compare = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:n:w:t:l:c")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (bench_parse_format(optarg, &format) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                ops = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'l':
+                if (strcmp(optarg, "ticket") == 0)
+                    lock = MEM_LOCK_TICKET;
+                else if (strcmp(optarg, "adaptive") == 0)
+                    lock = MEM_LOCK_ADAPTIVE;
+                else if (strcmp(optarg, "mutex") == 0)
+                    lock = MEM_LOCK_MUTEX;
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'c':
+                compare = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (ops == 0 || max_threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (compare) {
+        // Pin the mmap threshold so the pool's memory comes from fresh
+        // mappings every run instead of recycled, already resident heap
+        mallopt(M_MMAP_THRESHOLD, 128 * 1024);
+        const char *preload = getenv("LD_PRELOAD");
+        if (preload && *preload)
+            fprintf(stderr, "malloc rows use LD_PRELOAD=%s\n", preload);
+    }
+
+    bench_print_header(stdout, format);
+    bench_size_dist dists[] = {BENCH_SIZE_FIXED, BENCH_SIZE_UNIFORM,
+                               BENCH_SIZE_POWER_LAW};
+    for (size_t d = 0; d < sizeof(dists) / sizeof(dists[0]); d++) {
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            double baseline[OP_KINDS + 1] = {0};
+            run(format, &pool_backend, lock, dists[d], threads, ops, warmup,
+                compare ? baseline : NULL);
+            if (compare)
+                run(format, &malloc_backend, lock, dists[d], threads, ops,
+                    warmup, baseline);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#define _GNU_SOURCE
+#include "brlock.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t next_slot = 0;
+
+// Slot of the calling thread, one past the index so 0 means unassigned
+static __thread uint32_t self_slot = 0;
+
+/// Read sections the calling thread is in, one entry per lock
+static __thread struct {
+    brlock *lock;
+    unsigned depth;
+} held[BRLOCK_MAX_NESTED];
+
+static inline brlock_slot *own_slot(brlock *lock) {
+    if (self_slot == 0)
+        self_slot = __atomic_fetch_add(&next_slot, 1, __ATOMIC_RELAXED) %
+                        BRLOCK_SLOTS +
+                    1;
+    return &lock->slots[self_slot - 1];
+}
+
+/// @brief Index of @p lock in the calling thread's held list, -1 if the
+/// thread is not reading it. NULL finds a free entry.
+static inline int held_index(brlock *lock) {
+    for (int i = 0; i < BRLOCK_MAX_NESTED; i++)
+        if (held[i].lock == lock) return i;
+    return -1;
+}
+
+/// @brief Initializes @p lock
+/// @return 0, or -1 if the reader slots could not be allocated
+int brlock_init(brlock *lock) {
+    lock->writer = 0;
+    lock->slots = aligned_alloc(64, BRLOCK_SLOTS * sizeof(brlock_slot));
+    if (!lock->slots) return -1;
+    memset(lock->slots, 0, BRLOCK_SLOTS * sizeof(brlock_slot));
+    pthread_mutex_init(&lock->writer_mutex, NULL);
+    return 0;
+}
+
+/// @brief Enters a read section, sections may nest. A nested section never
+/// waits, a waiting writer could otherwise wait for the outer one forever.
+/// Aborts if the thread already reads BRLOCK_MAX_NESTED other locks, as the
+/// section could not be recorded and a nested one would then wait.
+void brlock_read_lock(brlock *lock) {
+    int i = held_index(lock);
+    if (i >= 0) {
+        held[i].depth++;
+        return;
+    }
+    i = held_index(NULL);
+    if (i < 0) {
+        fprintf(stderr, "brlock: more than %d brlocks read by one thread\n", BRLOCK_MAX_NESTED);
+        abort();
+    }
+    brlock_slot *slot = own_slot(lock);
+    for (;;) {
+        __atomic_add_fetch(&slot->readers, 1, __ATOMIC_SEQ_CST);
+        // Pairs with the writer raising its flag before it reads the slots:
+        // either it sees this reader or this reader sees the flag
+        if (!__atomic_load_n(&lock->writer, __ATOMIC_SEQ_CST)) break;
+        __atomic_sub_fetch(&slot->readers, 1, __ATOMIC_RELEASE);
+        // Sleep until the writer is done instead of spinning on the flag
+        pthread_mutex_lock(&lock->writer_mutex);
+        pthread_mutex_unlock(&lock->writer_mutex);
+    }
+    held[i].lock = lock;
+    held[i].depth = 1;
+}
+
+/// @brief Leaves a read section
+void brlock_read_unlock(brlock *lock) {
+    int i = held_index(lock);
+    if (i >= 0) {
+        if (--held[i].depth > 0) return;
+        held[i].lock = NULL;
+    }
+    __atomic_sub_fetch(&own_slot(lock)->readers, 1, __ATOMIC_RELEASE);
+}
+
+/// @brief Waits until the caller is the only thread in @p lock
+void brlock_write_lock(brlock *lock) {
+    pthread_mutex_lock(&lock->writer_mutex);
+    __atomic_store_n(&lock->writer, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < BRLOCK_SLOTS; i++) {
+        while (__atomic_load_n(&lock->slots[i].readers, __ATOMIC_ACQUIRE) != 0)
+            sched_yield();
+    }
+}
+
+/// @brief Releases the write side
+void brlock_write_unlock(brlock *lock) {
+    __atomic_store_n(&lock->writer, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&lock->writer_mutex);
+}
+
+/// @brief Frees the reader slots, @p lock must not be held
+void brlock_destroy(brlock *lock) {
+    free(lock->slots);
+    lock->slots = NULL;
+    pthread_mutex_destroy(&lock->writer_mutex);
+}
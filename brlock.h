@@ -0,0 +1,49 @@
+// brlock.h
+#ifndef BRLOCK_H
+#define BRLOCK_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+/// Reader indicators per lock, threads beyond this many share them
+#define BRLOCK_SLOTS 64
+
+/// Distinct brlocks one thread can hold for reading at the same time; taking
+/// one more aborts
+#define BRLOCK_MAX_NESTED 8
+
+/// Reader count of the threads mapped to one slot, alone on its cache line
+typedef struct {
+    uint32_t readers;
+} __attribute__((aligned(64))) brlock_slot;
+
+/// @brief Big-reader lock. Readers only touch the slot of their own thread, so
+/// read-mostly workloads do not bounce a shared counter between CPUs. A writer
+/// raises a flag and waits for every slot to drain, which makes writing the
+/// expensive side.
+typedef struct brlock {
+    uint32_t writer;                // a writer holds or is taking the lock
+    pthread_mutex_t writer_mutex;   // serializes writers, readers wait on it
+    brlock_slot *slots;             // BRLOCK_SLOTS reader indicators
+} brlock;
+
+/// @brief Initializes @p lock
+/// @return 0, or -1 if the reader slots could not be allocated
+int brlock_init(brlock *lock);
+
+/// @brief Enters a read section, sections may nest
+void brlock_read_lock(brlock *lock);
+
+/// @brief Leaves a read section
+void brlock_read_unlock(brlock *lock);
+
+/// @brief Waits until the caller is the only thread in @p lock
+void brlock_write_lock(brlock *lock);
+
+/// @brief Releases the write side
+void brlock_write_unlock(brlock *lock);
+
+/// @brief Frees the reader slots, @p lock must not be held
+void brlock_destroy(brlock *lock);
+
+#endif  // BRLOCK_H
@@ -1,21 +1,79 @@
 #define _GNU_SOURCE
 #include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
-
-char tmpbuff[1024];
-unsigned long tmppos = 0;
-unsigned long tmpallocs = 0;
+#include "alloc_trace.h"
 
 void *memset(void*,int,size_t);
 void *memmove(void *to, const void *from, size_t size);
 
+#define TLS __thread __attribute__((tls_model("initial-exec")))
+
+/*=========================================================
+ * bootstrap: until dlsym has found the real allocator, and for every
+ * thread while it is being looked up, blocks come from a static arena. A
+ * block is carved off with one atomic bump and never reused; freeing it
+ * does nothing. Each block is preceded by its size so realloc can move it.
+ */
+
+#define BOOTSTRAP_SIZE (256 * 1024)
+#define BOOTSTRAP_HEADER 16  // keeps blocks 16-byte aligned like malloc's
+
+static char tmpbuff[BOOTSTRAP_SIZE] __attribute__((aligned(64)));
+static uintptr_t tmppos = 0;  // bytes of tmpbuff handed out
+static unsigned long tmpallocs = 0;
+
+static void *bootstrap_alloc(size_t size, size_t align){
+  if (align < BOOTSTRAP_HEADER)
+    align = BOOTSTRAP_HEADER;
+  uintptr_t base = (uintptr_t)tmpbuff;
+  uintptr_t pos = __atomic_load_n(&tmppos, __ATOMIC_RELAXED), start, end;
+  do {
+    start = (base + pos + BOOTSTRAP_HEADER + align - 1) & ~(uintptr_t)(align - 1);
+    end = start + size;
+    if (end < start || end > base + sizeof(tmpbuff)) {
+      static const char message[] = "jcheck: too much memory requested during initialisation - increase tmpbuff size\n";
+      if (write(2, message, sizeof(message) - 1) < 0) {}
+      errno = ENOMEM;
+      return NULL;
+    }
+  } while (!__atomic_compare_exchange_n(&tmppos, &pos, end - base, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  ((size_t *)start)[-1] = size;
+  __atomic_add_fetch(&tmpallocs, 1, __ATOMIC_RELAXED);
+  return (void *)start;
+}
+
+static int is_bootstrap(void *ptr){
+  return ptr >= (void *)tmpbuff && ptr < (void *)(tmpbuff + sizeof(tmpbuff));
+}
+
+static size_t bootstrap_size(void *ptr){
+  return ((size_t *)ptr)[-1];
+}
+
+static int ensure_init();
+
 /*=========================================================
  * interception points
  */
 
+// everything but the opt-in text log: with CM2_LOG=text every call is
+// printed to stdout as it happens, which costs a formatted write per call
+static int hooked = 0;
+
 static void * (*myfn_calloc)(size_t nmemb, size_t size);
 static void * (*myfn_malloc)(size_t size);
 static void   (*myfn_free)(void *ptr);
@@ -24,6 +82,847 @@ static void * (*myfn_memalign)(size_t blocksize, size_t bytes);
 static void * (*myfn_mmap)(void *ptr,  size_t length, int prot, int flags, int fd, off_t offset);
 static int (*myfn_munmap)(void *ptr, size_t length);
 
+/*=========================================================
+ * binary trace: with CM2_TRACE=<file> every call is written to <file> as an
+ * alloc_trace_record. "%p" in the name is replaced by the pid so that child
+ * processes get their own trace. Unless the profile, the stats or the text
+ * log are asked for instead, the trace goes to TRACE_DEFAULT_FILE.
+ *
+ * A call only appends its record to a ring owned by the calling thread. A
+ * background thread writes the rings out in batches every
+ * CM2_TRACE_FLUSH_MS milliseconds (default 100, 0 for no thread), a thread
+ * whose ring is full writes it out itself, and everything left is written
+ * at exit. With CM2_TRACE_SAMPLE=<n> only blocks whose address hashes to
+ * 1 in n are traced, a block is either traced from allocation to free or
+ * not at all.
+ * Nothing here may call malloc.
+ */
+
+#define TRACE_RING_RECORDS 2048  // per thread, a power of two
+#define TRACE_DEFAULT_FILE "cm2-%p.trace"
+
+typedef struct trace_ring {
+  alloc_trace_record records[TRACE_RING_RECORDS];
+  uint64_t head;            // next record the owner writes
+  uint64_t tail;            // next record to write out
+  int flushing;             // taken by whoever writes the ring out
+  int owned;                // a live thread appends to the ring
+  struct trace_ring *next;  // every ring ever made, never unlinked
+} trace_ring;
+
+static int trace_fd = -1;
+static uint32_t trace_threads = 0;
+static uint32_t trace_sample = 1;
+static unsigned trace_flush_ms = 100;
+static int trace_flusher_started = 0;
+static int trace_exiting = 0;
+static trace_ring *trace_rings = NULL;
+static pthread_key_t trace_ring_key;
+static TLS uint32_t trace_thread = 0;
+static TLS trace_ring *my_ring = NULL;
+static TLS int in_trace = 0;  // calls made by the tracer itself go untraced
+
+static uint64_t trace_now(){
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static void trace_release(void *ring);
+
+// copies name to path, replacing "%p" with the pid
+static void expand_path(const char *name, char *path, size_t size){
+  size_t len = 0;
+  for (const char *c = name; *c && len < size - 16; c++) {
+    if (c[0] == '%' && c[1] == 'p') {
+      len += snprintf(path + len, size - len, "%d", (int)getpid());
+      c++;
+    }
+    else
+      path[len++] = *c;
+  }
+  path[len] = '\0';
+}
+
+// 1 in rate addresses, the same ones every time
+static int address_sampled(void *ptr, uint32_t rate){
+  return rate <= 1 || (((uintptr_t)ptr >> 4) * 0x9e3779b97f4a7c15ULL >> 40) % rate == 0;
+}
+
+static void trace_open(){
+  const char *name = getenv("CM2_TRACE");
+  if (!name && !getenv("CM2_PROFILE") && !getenv("CM2_STATS") && !getenv("CM2_LOG"))
+    name = TRACE_DEFAULT_FILE;
+  if (!name || !*name)
+    return;
+
+  char path[4096];
+  expand_path(name, path, sizeof(path));
+
+  const char *sample = getenv("CM2_TRACE_SAMPLE");
+  if (sample && atoi(sample) > 1)
+    trace_sample = atoi(sample);
+  const char *flush_ms = getenv("CM2_TRACE_FLUSH_MS");
+  if (flush_ms)
+    trace_flush_ms = atoi(flush_ms);
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  alloc_trace_header header = {ALLOC_TRACE_MAGIC, ALLOC_TRACE_VERSION, sizeof(alloc_trace_record)};
+  if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+    close(fd);
+    return;
+  }
+  pthread_key_create(&trace_ring_key, trace_release);
+  trace_fd = fd;
+}
+
+// writes out what ring holds, unless another thread is already at it
+static void trace_flush(trace_ring *ring){
+  if (__atomic_exchange_n(&ring->flushing, 1, __ATOMIC_ACQUIRE))
+    return;
+  uint64_t tail = ring->tail;
+  uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  while (tail < head) {
+    size_t at = tail & (TRACE_RING_RECORDS - 1);
+    size_t n = head - tail;
+    if (at + n > TRACE_RING_RECORDS)
+      n = TRACE_RING_RECORDS - at;
+    // O_APPEND keeps batches from different threads whole; records that
+    // cannot be written are dropped rather than blocking the owner
+    if (write(trace_fd, &ring->records[at], n * sizeof(alloc_trace_record)) != (ssize_t)(n * sizeof(alloc_trace_record))) {
+      tail = head;
+      break;
+    }
+    tail += n;
+  }
+  __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  __atomic_store_n(&ring->flushing, 0, __ATOMIC_RELEASE);
+}
+
+static void trace_flush_all(){
+  for (trace_ring *ring = __atomic_load_n(&trace_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+    trace_flush(ring);
+}
+
+static void *trace_flusher(void *unused){
+  struct timespec interval = {trace_flush_ms / 1000, (trace_flush_ms % 1000) * 1000000L};
+  for (;;) {
+    nanosleep(&interval, NULL);
+    trace_flush_all();
+  }
+  return unused;
+}
+
+// hands the ring of an exiting thread to the next new thread
+static void trace_release(void *ring){
+  my_ring = NULL;
+  __atomic_store_n(&((trace_ring *)ring)->owned, 0, __ATOMIC_RELEASE);
+}
+
+// gives the calling thread a ring, an abandoned one if there is one
+static trace_ring *trace_claim(){
+  trace_ring *ring;
+  for (ring = __atomic_load_n(&trace_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+    int expected = 0;
+    if (!__atomic_load_n(&ring->owned, __ATOMIC_RELAXED) &&
+        __atomic_compare_exchange_n(&ring->owned, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      break;
+  }
+  if (!ring) {
+    ring = myfn_mmap(NULL, sizeof(trace_ring), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+      return NULL;
+    ring->owned = 1;
+    ring->next = __atomic_load_n(&trace_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&trace_rings, &ring->next, ring, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+  }
+  my_ring = ring;
+  pthread_setspecific(trace_ring_key, ring);
+  return ring;
+}
+
+static void trace_push(const alloc_trace_record *record){
+  trace_ring *ring = my_ring ? my_ring : trace_claim();
+  if (!ring)
+    return;
+
+  int expected = 0;
+  if (trace_flush_ms && !__atomic_load_n(&trace_flusher_started, __ATOMIC_RELAXED) &&
+      __atomic_compare_exchange_n(&trace_flusher_started, &expected, 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    pthread_t flusher;
+    if (pthread_create(&flusher, NULL, trace_flusher, NULL) == 0)
+      pthread_detach(flusher);
+  }
+
+  uint64_t head = ring->head;
+  while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == TRACE_RING_RECORDS) {
+    trace_flush(ring);
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == TRACE_RING_RECORDS)
+      sched_yield();  // the flusher has it
+  }
+  ring->records[head & (TRACE_RING_RECORDS - 1)] = *record;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+  // past the exit flush nobody else will write it out
+  if (__atomic_load_n(&trace_exiting, __ATOMIC_RELAXED))
+    trace_flush(ring);
+}
+
+__attribute__((destructor)) static void trace_finish(){
+  if (trace_fd < 0)
+    return;
+  __atomic_store_n(&trace_exiting, 1, __ATOMIC_SEQ_CST);
+  trace_flush_all();
+}
+
+// records a call that was entered at start
+static void trace(alloc_trace_op op, size_t size, void *id, void *old_id, uint64_t start){
+  uint64_t duration = trace_now() - start;
+  if (in_trace)
+    return;
+  if (trace_sample > 1) {
+    int keep = id && address_sampled(id, trace_sample);
+    int keep_old = old_id && address_sampled(old_id, trace_sample);
+    if (!keep && !keep_old)
+      return;
+    // a realloc whose new block is not sampled reads as realloc(p, 0)
+    if (!keep) {
+      id = NULL;
+      size = 0;
+    }
+    if (!keep_old)
+      old_id = NULL;
+  }
+  in_trace = 1;
+  if (!trace_thread)
+    trace_thread = __atomic_add_fetch(&trace_threads, 1, __ATOMIC_RELAXED);
+
+  alloc_trace_record record = {
+    .start_ns = start,
+    .size = size,
+    .id = (uintptr_t)id,
+    .old_id = (uintptr_t)old_id,
+    .thread = trace_thread,
+    .duration_ns = duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration,
+    .op = op,
+  };
+  trace_push(&record);
+  in_trace = 0;
+}
+
+/*=========================================================
+ * live table: sampled blocks from allocation to release, with their call
+ * site (for the profile) and birth time (for the stats). Sharded by
+ * address, each shard an open addressing table behind a tiny spinlock.
+ */
+
+#define LIVE_SHARDS 64          // each with a lock
+#define LIVE_SHARD_BLOCKS 8192  // per shard, a power of two
+#define NO_SITE UINT32_MAX
+
+typedef struct {
+  uintptr_t address;            // 0 for an empty entry
+  uint32_t site;                // NO_SITE unless profiling
+  uint64_t size;
+  uint64_t born_ns;
+} live_block;
+
+typedef struct {
+  int lock;
+  live_block blocks[LIVE_SHARD_BLOCKS];
+} live_shard;
+
+static live_shard *live_shards = NULL;
+static uint32_t live_sample = 1;  // 1 in n blocks go into the table
+static uint64_t live_dropped = 0;  // blocks that found no room
+
+static int live_open(){
+  if (!live_shards) {
+    live_shard *shards = myfn_mmap(NULL, LIVE_SHARDS * sizeof(live_shard), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (shards == MAP_FAILED)
+      return 0;
+    live_shards = shards;
+  }
+  return 1;
+}
+
+static live_shard *live_shard_of(uintptr_t address){
+  return &live_shards[(address >> 4) * 0x9e3779b97f4a7c15ULL >> 58];
+}
+
+static size_t live_home(uintptr_t address){
+  return ((address >> 4) * 0xff51afd7ed558ccdULL >> 40) & (LIVE_SHARD_BLOCKS - 1);
+}
+
+static void shard_lock(live_shard *shard){
+  while (__atomic_exchange_n(&shard->lock, 1, __ATOMIC_ACQUIRE))
+    sched_yield();
+}
+
+static void shard_unlock(live_shard *shard){
+  __atomic_store_n(&shard->lock, 0, __ATOMIC_RELEASE);
+}
+
+// returns 0 if the shard is full
+static int live_put(const live_block *entry){
+  live_shard *shard = live_shard_of(entry->address);
+  int stored = 0;
+  shard_lock(shard);
+  for (size_t probe = 0, i = live_home(entry->address); probe < LIVE_SHARD_BLOCKS; probe++, i = (i + 1) & (LIVE_SHARD_BLOCKS - 1)) {
+    if (shard->blocks[i].address == 0) {
+      shard->blocks[i] = *entry;
+      stored = 1;
+      break;
+    }
+  }
+  shard_unlock(shard);
+  if (!stored)
+    __atomic_add_fetch(&live_dropped, 1, __ATOMIC_RELAXED);
+  return stored;
+}
+
+// removes address into found; returns 0 if it was not in the table
+static int live_take(uintptr_t address, live_block *found){
+  live_shard *shard = live_shard_of(address);
+  found->address = 0;
+  shard_lock(shard);
+  size_t i = live_home(address);
+  for (size_t probe = 0; probe < LIVE_SHARD_BLOCKS && shard->blocks[i].address; probe++, i = (i + 1) & (LIVE_SHARD_BLOCKS - 1)) {
+    if (shard->blocks[i].address == address) {
+      *found = shard->blocks[i];
+      break;
+    }
+  }
+  if (found->address) {
+    // backward shift deletion keeps probe chains unbroken
+    size_t hole = i;
+    for (size_t j = (i + 1) & (LIVE_SHARD_BLOCKS - 1); shard->blocks[j].address; j = (j + 1) & (LIVE_SHARD_BLOCKS - 1)) {
+      size_t home = live_home(shard->blocks[j].address);
+      if (((j - home) & (LIVE_SHARD_BLOCKS - 1)) >= ((j - hole) & (LIVE_SHARD_BLOCKS - 1))) {
+        shard->blocks[hole] = shard->blocks[j];
+        hole = j;
+      }
+    }
+    shard->blocks[hole].address = 0;
+  }
+  shard_unlock(shard);
+  return found->address != 0;
+}
+
+/*=========================================================
+ * heap profile: with CM2_PROFILE=<file> ("%p" as above) sampled
+ * allocations remember their call site, a short backtrace, in the live
+ * table until they are freed. A report of the call sites holding the most
+ * live bytes and making the most allocations goes to <file> at exit, and
+ * every CM2_PROFILE_INTERVAL_MS milliseconds if that is set.
+ * CM2_PROFILE_SAMPLE=<n> profiles 1 in n blocks (by address, like the
+ * trace) and scales the numbers back up.
+ * Tables are fixed size and mmapped; nothing here may call malloc.
+ */
+
+#define PROFILE_DEPTH 8           // frames kept per call site
+#define PROFILE_SITES 4096        // call sites, a power of two
+#define PROFILE_TOP 10            // call sites per ranking in a report
+
+typedef struct {
+  uint64_t hash;                // of the frames, 0 while the slot is free
+  int ready;                    // frames are filled in
+  int depth;
+  void *frames[PROFILE_DEPTH];
+  uint64_t allocs;              // since start
+  uint64_t bytes;
+  uint64_t live;                // allocated and not yet freed
+  uint64_t live_bytes;
+} profile_site;
+
+static int profile_fd = -1;
+static uint32_t profile_sample = 1;
+static unsigned profile_interval_ms = 0;
+static int profile_reporter_started = 0;
+static profile_site *profile_sites;
+static TLS int in_profile = 0;  // also guards the stats hooks
+
+static void profile_open(){
+  const char *name = getenv("CM2_PROFILE");
+  if (!name || !*name)
+    return;
+
+  char path[4096];
+  expand_path(name, path, sizeof(path));
+  const char *sample = getenv("CM2_PROFILE_SAMPLE");
+  if (sample && atoi(sample) > 1)
+    profile_sample = atoi(sample);
+  const char *interval = getenv("CM2_PROFILE_INTERVAL_MS");
+  if (interval)
+    profile_interval_ms = atoi(interval);
+
+  profile_sites = myfn_mmap(NULL, PROFILE_SITES * sizeof(profile_site), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (profile_sites == MAP_FAILED || !live_open())
+    return;
+  live_sample = profile_sample;
+  profile_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+}
+
+static uint64_t hash_frames(void **frames, int depth){
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < depth; i++)
+    hash = (hash ^ (uintptr_t)frames[i]) * 0x100000001b3ULL;
+  return hash ? hash : 1;
+}
+
+// finds or adds the site for frames, NO_SITE if the table is full
+static uint32_t profile_site_of(void **frames, int depth){
+  uint64_t hash = hash_frames(frames, depth);
+  for (uint32_t probe = 0; probe < PROFILE_SITES; probe++) {
+    uint32_t i = (hash + probe) & (PROFILE_SITES - 1);
+    profile_site *site = &profile_sites[i];
+    uint64_t seen = __atomic_load_n(&site->hash, __ATOMIC_ACQUIRE);
+    if (seen == 0) {
+      if (!__atomic_compare_exchange_n(&site->hash, &seen, hash, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        if (seen != hash)
+          continue;
+        return i;
+      }
+      for (int f = 0; f < depth; f++)
+        site->frames[f] = frames[f];
+      site->depth = depth;
+      __atomic_store_n(&site->ready, 1, __ATOMIC_RELEASE);
+      return i;
+    }
+    if (seen == hash)
+      return i;
+  }
+  return NO_SITE;
+}
+
+static void profile_report(int last);
+
+static void *profile_reporter(void *unused){
+  struct timespec interval = {profile_interval_ms / 1000, (profile_interval_ms % 1000) * 1000000L};
+  for (;;) {
+    nanosleep(&interval, NULL);
+    profile_report(0);
+  }
+  return unused;
+}
+
+static void profile_start_reporter(){
+  int expected = 0;
+  if (profile_interval_ms && !__atomic_load_n(&profile_reporter_started, __ATOMIC_RELAXED) &&
+      __atomic_compare_exchange_n(&profile_reporter_started, &expected, 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    pthread_t reporter;
+    if (pthread_create(&reporter, NULL, profile_reporter, NULL) == 0)
+      pthread_detach(reporter);
+  }
+}
+
+static void print_to(int fd, const char *text){
+  size_t len = 0;
+  while (text[len])
+    len++;
+  if (write(fd, text, len) < 0)
+    return;
+}
+
+// writes the PROFILE_TOP sites with the largest counter at offset field
+static void profile_rank(const char *title, size_t field){
+  char line[256];
+  int taken[PROFILE_TOP];
+  print_to(profile_fd, title);
+  for (int rank = 0; rank < PROFILE_TOP; rank++) {
+    int best = -1;
+    uint64_t best_value = 0;
+    for (int i = 0; i < PROFILE_SITES; i++) {
+      if (!__atomic_load_n(&profile_sites[i].ready, __ATOMIC_ACQUIRE))
+        continue;
+      uint64_t value = *(uint64_t *)((char *)&profile_sites[i] + field);
+      int seen = 0;
+      for (int t = 0; t < rank; t++)
+        seen |= taken[t] == i;
+      if (!seen && value > best_value) {
+        best = i;
+        best_value = value;
+      }
+    }
+    if (best < 0)
+      break;
+    taken[rank] = best;
+    profile_site *site = &profile_sites[best];
+    snprintf(line, sizeof(line), "#%d: %" PRIu64 " live bytes in %" PRIu64 " blocks, %" PRIu64 " bytes in %" PRIu64 " allocations\n",
+             rank + 1, site->live_bytes * profile_sample, site->live * profile_sample,
+             site->bytes * profile_sample, site->allocs * profile_sample);
+    print_to(profile_fd, line);
+    backtrace_symbols_fd(site->frames, site->depth, profile_fd);
+  }
+}
+
+// one report at a time, the periodic ones end with the one at exit
+static pthread_mutex_t profile_report_lock = PTHREAD_MUTEX_INITIALIZER;
+static int profile_finished = 0;
+
+// last: the report at exit, no periodic one may follow it
+static void profile_report(int last){
+  if (profile_fd < 0)
+    return;
+  pthread_mutex_lock(&profile_report_lock);
+  if (profile_finished) {
+    pthread_mutex_unlock(&profile_report_lock);
+    return;
+  }
+  uint64_t live = 0, live_bytes = 0, allocs = 0, bytes = 0;
+  for (int i = 0; i < PROFILE_SITES; i++) {
+    if (!__atomic_load_n(&profile_sites[i].ready, __ATOMIC_ACQUIRE))
+      continue;
+    live += profile_sites[i].live;
+    live_bytes += profile_sites[i].live_bytes;
+    allocs += profile_sites[i].allocs;
+    bytes += profile_sites[i].bytes;
+  }
+  char line[256];
+  snprintf(line, sizeof(line), "heap profile of %d at %" PRIu64 " ms: %" PRIu64 " live bytes in %" PRIu64 " blocks, %" PRIu64 " bytes in %" PRIu64 " allocations (1 in %" PRIu32 " sampled, %" PRIu64 " dropped)\n",
+           (int)getpid(), trace_now() / 1000000, live_bytes * profile_sample, live * profile_sample,
+           bytes * profile_sample, allocs * profile_sample, profile_sample, live_dropped);
+  print_to(profile_fd, line);
+  profile_rank("top call sites by live bytes:\n", offsetof(profile_site, live_bytes));
+  profile_rank("top call sites by allocations:\n", offsetof(profile_site, allocs));
+  print_to(profile_fd, "\n");
+  profile_finished = last;
+  pthread_mutex_unlock(&profile_report_lock);
+}
+
+// backtrace() loads its unwinder on first use, which allocates; do that
+// before main rather than inside the first profiled malloc
+__attribute__((constructor)) static void profile_prime(){
+  if (!getenv("CM2_PROFILE"))
+    return;
+  ensure_init();
+  void *frame;
+  in_profile = 1;
+  backtrace(&frame, 1);
+  in_profile = 0;
+}
+
+__attribute__((destructor)) static void profile_finish(){
+  in_profile = 1;
+  profile_report(1);
+}
+
+/*=========================================================
+ * allocation stats: with CM2_STATS=<file> ("%p" as above) every thread
+ * counts its requests per size bucket, and the lifetimes and realloc
+ * growth of the blocks in the live table, 1 in CM2_STATS_SAMPLE of them
+ * (or 1 in CM2_PROFILE_SAMPLE when profiling too). Counters sit in a block
+ * owned by the thread, which alone writes them; at exit the blocks are
+ * merged into histograms written to <file>, ending in a size class line
+ * for libmmpreload.so.
+ * Nothing here may call malloc.
+ */
+
+#define STATS_FINE_LIMIT 1024       // sizes up to this in 16 byte steps
+#define STATS_SIZE_BUCKETS 281      // then 4 per power of two up to 2^64
+#define STATS_LIFETIME_BUCKETS 65   // a power of two of nanoseconds each
+#define STATS_CLASSES 16            // most size classes suggested
+#define STATS_CLASS_LIMIT 4096      // largest size class suggested
+#define STATS_CLASS_COVERAGE 95     // percent of requests up to the limit
+
+enum {
+  GROWTH_SHRINK, GROWTH_SAME, GROWTH_1_25, GROWTH_1_5, GROWTH_2, GROWTH_4, GROWTH_MORE, GROWTH_UNKNOWN,
+  GROWTH_BUCKETS
+};
+
+static const char *growth_names[GROWTH_BUCKETS] = {
+  "shrink", "same", "up_to_1.25x", "up_to_1.5x", "up_to_2x", "up_to_4x", "over_4x", "unknown"
+};
+
+typedef struct stats_block {
+  uint64_t sizes[STATS_SIZE_BUCKETS];          // requests
+  uint64_t lifetimes[STATS_LIFETIME_BUCKETS];  // sampled blocks freed
+  uint64_t growth[GROWTH_BUCKETS];             // reallocs by new / old size
+  uint64_t in_place;                           // reallocs that kept the block
+  uint64_t moved;
+  int owned;                                   // a live thread counts here
+  struct stats_block *next;                    // every block ever made
+} stats_block;
+
+static int stats_fd = -1;
+static uint32_t stats_sample = 1;
+static stats_block *stats_blocks = NULL;
+static pthread_key_t stats_key;
+static TLS stats_block *my_stats = NULL;
+
+static void stats_release(void *block);
+
+static void stats_open(){
+  const char *name = getenv("CM2_STATS");
+  if (!name || !*name)
+    return;
+
+  char path[4096];
+  expand_path(name, path, sizeof(path));
+  const char *sample = getenv("CM2_STATS_SAMPLE");
+  if (sample && atoi(sample) > 1)
+    stats_sample = atoi(sample);
+
+  if (!live_open())
+    return;
+  if (profile_fd < 0)
+    live_sample = stats_sample;
+  pthread_key_create(&stats_key, stats_release);
+  stats_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+}
+
+// sizes up to STATS_FINE_LIMIT by 16 bytes, then quarters of powers of two
+static int size_bucket(uint64_t size){
+  if (size <= STATS_FINE_LIMIT)
+    return (size + 15) / 16;
+  int log = 63 - __builtin_clzll(size - 1);
+  return STATS_FINE_LIMIT / 16 + 1 + (log - 10) * 4 + ((size - 1) >> (log - 2) & 3);
+}
+
+// the largest size in bucket
+static uint64_t size_bucket_high(int bucket){
+  if (bucket <= STATS_FINE_LIMIT / 16)
+    return bucket * 16;
+  bucket -= STATS_FINE_LIMIT / 16 + 1;
+  int log = bucket / 4 + 10;
+  return log == 63 && bucket % 4 == 3 ? UINT64_MAX : (uint64_t)(5 + bucket % 4) << (log - 2);
+}
+
+static int growth_bucket(uint64_t old_size, uint64_t size){
+  if (old_size == 0)
+    return GROWTH_UNKNOWN;
+  if (size < old_size)
+    return GROWTH_SHRINK;
+  if (size == old_size)
+    return GROWTH_SAME;
+  if (size * 4 <= old_size * 5)
+    return GROWTH_1_25;
+  if (size * 2 <= old_size * 3)
+    return GROWTH_1_5;
+  if (size <= old_size * 2)
+    return GROWTH_2;
+  return size <= old_size * 4 ? GROWTH_4 : GROWTH_MORE;
+}
+
+// hands the block of an exiting thread to the next new thread
+static void stats_release(void *block){
+  my_stats = NULL;
+  __atomic_store_n(&((stats_block *)block)->owned, 0, __ATOMIC_RELEASE);
+}
+
+// gives the calling thread a block, an abandoned one if there is one
+static stats_block *stats_claim(){
+  stats_block *block;
+  for (block = __atomic_load_n(&stats_blocks, __ATOMIC_ACQUIRE); block; block = block->next) {
+    int expected = 0;
+    if (!__atomic_load_n(&block->owned, __ATOMIC_RELAXED) &&
+        __atomic_compare_exchange_n(&block->owned, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      break;
+  }
+  if (!block) {
+    block = myfn_mmap(NULL, sizeof(stats_block), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED)
+      return NULL;
+    block->owned = 1;
+    block->next = __atomic_load_n(&stats_blocks, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&stats_blocks, &block->next, block, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+  }
+  my_stats = block;
+  pthread_setspecific(stats_key, block);
+  return block;
+}
+
+// only the owner writes a counter, the merge at exit reads it
+static void stats_bump(uint64_t *counter){
+  __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+static stats_block *stats_mine(){
+  return my_stats ? my_stats : stats_claim();
+}
+
+static void stats_request(size_t size){
+  stats_block *block = stats_mine();
+  if (block)
+    stats_bump(&block->sizes[size_bucket(size)]);
+}
+
+static void stats_lifetime(uint64_t ns){
+  stats_block *block = stats_mine();
+  if (block)
+    stats_bump(&block->lifetimes[ns ? 64 - __builtin_clzll(ns) : 0]);
+}
+
+// old_size is 0 if the old block was not sampled
+static void stats_realloc(uint64_t old_size, size_t size, int moved){
+  stats_block *block = stats_mine();
+  if (!block)
+    return;
+  stats_bump(&block->growth[growth_bucket(old_size, size)]);
+  stats_bump(moved ? &block->moved : &block->in_place);
+}
+
+// writes the size classes that cover STATS_CLASS_COVERAGE percent of the
+// requests up to STATS_CLASS_LIMIT bytes, picking the busiest buckets first
+static void stats_classes(const stats_block *total){
+  int small = size_bucket(STATS_CLASS_LIMIT);
+  uint64_t requests = 0, covered = 0;
+  for (int b = 0; b <= small; b++)
+    requests += total->sizes[b];
+
+  int chosen[STATS_SIZE_BUCKETS] = {0};
+  int classes = 0;
+  while (classes < STATS_CLASSES && covered * 100 < requests * STATS_CLASS_COVERAGE) {
+    int best = -1;
+    for (int b = 0; b <= small; b++)
+      if (!chosen[b] && total->sizes[b] && (best < 0 || total->sizes[b] > total->sizes[best]))
+        best = b;
+    if (best < 0)
+      break;
+    chosen[best] = 1;
+    covered += total->sizes[best];
+    classes++;
+  }
+
+  char line[256];
+  snprintf(line, sizeof(line), "# size classes for libmmpreload.so, %" PRIu64 " of %" PRIu64 " requests up to %d bytes\n",
+           covered, requests, STATS_CLASS_LIMIT);
+  print_to(stats_fd, line);
+  size_t len = snprintf(line, sizeof(line), "MM_PRELOAD_CLASSES=");
+  const char *comma = "";
+  for (int b = 0; b <= small; b++) {
+    if (!chosen[b])
+      continue;
+    // bucket 0 holds malloc(0), which still needs a smallest class
+    len += snprintf(line + len, sizeof(line) - len, "%s%" PRIu64, comma, b ? size_bucket_high(b) : 16);
+    comma = ",";
+    if (b == 0)
+      b = 1;  // 16 is also bucket 1's class
+  }
+  snprintf(line + len, sizeof(line) - len, "\n");
+  print_to(stats_fd, line);
+}
+
+__attribute__((destructor)) static void stats_finish(){
+  if (stats_fd < 0)
+    return;
+  in_profile = 1;
+  static stats_block total;
+  for (stats_block *block = __atomic_load_n(&stats_blocks, __ATOMIC_ACQUIRE); block; block = block->next) {
+    for (int b = 0; b < STATS_SIZE_BUCKETS; b++)
+      total.sizes[b] += __atomic_load_n(&block->sizes[b], __ATOMIC_RELAXED);
+    for (int b = 0; b < STATS_LIFETIME_BUCKETS; b++)
+      total.lifetimes[b] += __atomic_load_n(&block->lifetimes[b], __ATOMIC_RELAXED);
+    for (int b = 0; b < GROWTH_BUCKETS; b++)
+      total.growth[b] += __atomic_load_n(&block->growth[b], __ATOMIC_RELAXED);
+    total.in_place += __atomic_load_n(&block->in_place, __ATOMIC_RELAXED);
+    total.moved += __atomic_load_n(&block->moved, __ATOMIC_RELAXED);
+  }
+
+  char line[256];
+  uint64_t requests = 0;
+  for (int b = 0; b < STATS_SIZE_BUCKETS; b++)
+    requests += total.sizes[b];
+  snprintf(line, sizeof(line), "# allocation stats of %d: %" PRIu64 " requests, lifetimes and reallocs of 1 in %" PRIu32 " blocks (%" PRIu64 " dropped)\n",
+           (int)getpid(), requests, live_sample, live_dropped);
+  print_to(stats_fd, line);
+
+  print_to(stats_fd, "# requests by size: size <low> <high> <count>\n");
+  for (int b = 0; b < STATS_SIZE_BUCKETS; b++) {
+    if (!total.sizes[b])
+      continue;
+    snprintf(line, sizeof(line), "size %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", b ? size_bucket_high(b - 1) + 1 : 0, size_bucket_high(b), total.sizes[b]);
+    print_to(stats_fd, line);
+  }
+
+  print_to(stats_fd, "# blocks by time from allocation to free: lifetime_ns <low> <high> <count>\n");
+  for (int b = 0; b < STATS_LIFETIME_BUCKETS; b++) {
+    if (!total.lifetimes[b])
+      continue;
+    uint64_t low = b ? 1ULL << (b - 1) : 0;
+    snprintf(line, sizeof(line), "lifetime_ns %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", low, b ? low * 2 - 1 : 0, total.lifetimes[b]);
+    print_to(stats_fd, line);
+  }
+
+  print_to(stats_fd, "# reallocs by new size / old size: realloc <growth> <count>\n");
+  for (int b = 0; b < GROWTH_BUCKETS; b++) {
+    snprintf(line, sizeof(line), "realloc %s %" PRIu64 "\n", growth_names[b], total.growth[b]);
+    print_to(stats_fd, line);
+  }
+  snprintf(line, sizeof(line), "realloc in_place %" PRIu64 "\nrealloc moved %" PRIu64 "\n", total.in_place, total.moved);
+  print_to(stats_fd, line);
+
+  stats_classes(&total);
+  close(stats_fd);
+  stats_fd = -1;
+}
+
+/*=========================================================
+ * hooks shared by the profile and the stats
+ */
+
+// counts a new block and enters it into the live table if it is sampled,
+// born_ns 0 meaning now. Must be called straight from the allocator entry
+// point, the call site backtrace skips exactly the two.
+__attribute__((noinline)) static void note_alloc(void *ptr, size_t size, uint64_t born_ns){
+  if (!ptr || in_profile)
+    return;
+  in_profile = 1;
+  if (stats_fd >= 0)
+    stats_request(size);
+  if (!live_shards || !address_sampled(ptr, live_sample)) {
+    in_profile = 0;
+    return;
+  }
+
+  live_block entry = {(uintptr_t)ptr, NO_SITE, size, born_ns ? born_ns : trace_now()};
+  profile_site *site = NULL;
+  if (profile_fd >= 0) {
+    profile_start_reporter();
+    void *frames[PROFILE_DEPTH + 2];
+    int depth = backtrace(frames, PROFILE_DEPTH + 2) - 2;
+    entry.site = depth > 0 ? profile_site_of(frames + 2, depth) : NO_SITE;
+    if (entry.site == NO_SITE) {
+      __atomic_add_fetch(&live_dropped, 1, __ATOMIC_RELAXED);
+      in_profile = 0;
+      return;
+    }
+    site = &profile_sites[entry.site];
+    __atomic_add_fetch(&site->allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&site->bytes, size, __ATOMIC_RELAXED);
+  }
+
+  if (live_put(&entry) && site) {
+    __atomic_add_fetch(&site->live, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&site->live_bytes, size, __ATOMIC_RELAXED);
+  }
+  in_profile = 0;
+}
+
+// takes ptr out of the live table, before the block is released so that
+// the address cannot be handed out again while it is still in there.
+// Returns its entry, address 0 if it was not sampled; a block that ends
+// here (rather than moving in a realloc) counts its lifetime.
+static live_block note_free(void *ptr, int ending){
+  live_block found = {0, NO_SITE, 0, 0};
+  if (!ptr || !live_shards || !address_sampled(ptr, live_sample) || !live_take((uintptr_t)ptr, &found))
+    return found;
+  if (found.site != NO_SITE) {
+    profile_site *site = &profile_sites[found.site];
+    __atomic_sub_fetch(&site->live, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&site->live_bytes, found.size, __ATOMIC_RELAXED);
+  }
+  if (ending && stats_fd >= 0 && !in_profile) {
+    in_profile = 1;
+    stats_lifetime(trace_now() - found.born_ns);
+    in_profile = 0;
+  }
+  return found;
+}
 
 static void init(){
   myfn_malloc     = dlsym(RTLD_NEXT, "malloc");
@@ -33,6 +932,11 @@ static void init(){
   myfn_memalign   = dlsym(RTLD_NEXT, "memalign");
   myfn_mmap       = dlsym(RTLD_NEXT, "mmap");
   myfn_munmap     = dlsym(RTLD_NEXT, "munmap");
+  trace_open();
+  profile_open();
+  stats_open();
+  const char *log = getenv("CM2_LOG");
+  hooked = !log || strcmp(log, "text") != 0;
   
   if (!myfn_malloc || !myfn_free || !myfn_calloc || !myfn_realloc || !myfn_memalign || !myfn_mmap || !myfn_munmap ) 
     {
@@ -41,32 +945,39 @@ static void init(){
     }
 }
 
-void *malloc(size_t size){
+static int init_state = 0;    // 0 not started, 1 running, 2 done
+static TLS int in_init = 0;
 
-  static int initializing = 0;
-  if (myfn_malloc == NULL){
-    if (!initializing){
-      initializing = 1;
-      init();
-      initializing = 0;
-      fprintf(stdout, "rMALLOC(%lu)\n", size);      
-      fprintf(stdout, "jcheck: allocated %lu bytes of temp memory in %lu chunks during initialization\n", tmppos, tmpallocs);
-    }
-    else {
-      if (tmppos + size < sizeof(tmpbuff)) {
-	void *retptr = tmpbuff + tmppos;
-	tmppos += size;
-	++tmpallocs;
-	return retptr;
-      }
-      else {
-	fprintf(stdout, "jcheck: too much memory requested during initialisation - increase tmpbuff size\n");
-	exit(1);
-      }
-    }
-  }
+// looks the real allocator up once; returns 0 while that is still going on
+// (in this thread or another), the caller then takes bootstrap memory
+static int ensure_init(){
+  if (__atomic_load_n(&init_state, __ATOMIC_ACQUIRE) == 2)
+    return 1;
+  int expected = 0;
+  if (in_init || !__atomic_compare_exchange_n(&init_state, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return 0;
+  in_init = 1;
+  init();
+  in_init = 0;
+  __atomic_store_n(&init_state, 2, __ATOMIC_RELEASE);
+  if (!hooked)
+    fprintf(stdout, "jcheck: allocated %lu bytes of temp memory in %lu chunks during initialization\n",
+            (unsigned long)__atomic_load_n(&tmppos, __ATOMIC_RELAXED), __atomic_load_n(&tmpallocs, __ATOMIC_RELAXED));
+  return 1;
+}
 
+void *malloc(size_t size){
+  if (!ensure_init())
+    return bootstrap_alloc(size, BOOTSTRAP_HEADER);
+
+  uint64_t start = trace_fd >= 0 ? trace_now() : 0;
   void *ptr = myfn_malloc(size);
+  if (hooked) {
+    if (trace_fd >= 0)
+      trace(ALLOC_TRACE_MALLOC, size, ptr, NULL, start);
+    note_alloc(ptr, size, 0);
+    return ptr;
+  }
   char buffer[50];
   int len=sprintf(buffer,"rMALLOc (%ld) at %p\n",size,ptr);
   write(1,buffer,len);
@@ -78,11 +989,25 @@ void free(void *ptr){
   //  if (myfn_malloc == NULL)
   //      init();
   
-  if (ptr >= (void*) tmpbuff && ptr <= (void*)(tmpbuff + tmppos))
-    fprintf(stdout, "freeing temp memory\n");
+  if (is_bootstrap(ptr)) {
+    if (!hooked)
+      fprintf(stdout, "freeing temp memory\n");
+  }
+  else if (!ptr || !ensure_init())
+    ;  // nothing but bootstrap blocks can exist before init
+  else if (hooked) {
+    uint64_t start = trace_fd >= 0 ? trace_now() : 0;
+    note_free(ptr, 1);
+    myfn_free(ptr);
+    if (ptr && trace_fd >= 0)
+      trace(ALLOC_TRACE_FREE, 0, ptr, NULL, start);
+  }
   else
     myfn_free(ptr);
 
+  if (hooked)
+    return;
+
   char buffer[50];
   int len=sprintf(buffer,"rFREE at %p\n",ptr);
   write(1,buffer,len);
@@ -91,21 +1016,40 @@ void free(void *ptr){
 void *realloc(void *ptr, size_t size)
 {
   char buffer[70];
-  int len=sprintf(buffer,"rREALLOC-> (%ld) at %p \n",size,ptr);
-  write(1,buffer,len);
-    if (myfn_malloc == NULL)
+  int len;
+  if (!hooked) {
+    len=sprintf(buffer,"rREALLOC-> (%ld) at %p \n",size,ptr);
+    write(1,buffer,len);
+  }
+    if (!ensure_init() || is_bootstrap(ptr))
     {
+        // bootstrap blocks move to real memory as soon as there is some
         void *nptr = malloc(size);
         if (nptr && ptr)
         {
-            memmove(nptr, ptr, size);
+            size_t old_size = is_bootstrap(ptr) ? bootstrap_size(ptr) : size;
+            memmove(nptr, ptr, old_size < size ? old_size : size);
             free(ptr);
         }
         return nptr;
     }
 
+    uint64_t start = trace_fd >= 0 ? trace_now() : 0;
+    // a failed realloc keeps ptr, which the profile then no longer counts;
+    // a moved block keeps its birth
+    live_block old = note_free(ptr, size == 0);
     void *nptr = myfn_realloc(ptr, size);
-
+    if (hooked) {
+        if (trace_fd >= 0)
+            trace(ALLOC_TRACE_REALLOC, size, nptr, ptr, start);
+        if (stats_fd >= 0 && ptr && nptr && !in_profile) {
+            in_profile = 1;
+            stats_realloc(old.size, size, nptr != ptr);
+            in_profile = 0;
+        }
+        note_alloc(nptr, size, old.born_ns);
+        return nptr;
+    }
 
     len=sprintf(buffer,"rREALLOC (%ld) at %p -> %p\n",size,ptr,nptr);
     write(1,buffer,len);
@@ -114,15 +1058,27 @@ void *realloc(void *ptr, size_t size)
 
 void *calloc(size_t nmemb, size_t size)
 {
-    if (myfn_malloc == NULL)
+    size_t bytes;
+    if (__builtin_mul_overflow(nmemb, size, &bytes)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (!ensure_init())
     {
-        void *ptr = malloc(nmemb*size);
+        void *ptr = bootstrap_alloc(bytes, BOOTSTRAP_HEADER);
         if (ptr)
-            memset(ptr, 0, nmemb*size);
+            memset(ptr, 0, bytes);
         return ptr;
     }
 
+    uint64_t start = trace_fd >= 0 ? trace_now() : 0;
     void *ptr = myfn_calloc(nmemb, size);
+    if (hooked) {
+        if (trace_fd >= 0)
+            trace(ALLOC_TRACE_CALLOC, bytes, ptr, NULL, start);
+        note_alloc(ptr, bytes, 0);
+        return ptr;
+    }
 
     char buffer[70];
     int len=sprintf(buffer,"rCALLOC (%ld,%ld) \n",nmemb, size);
@@ -133,7 +1089,17 @@ void *calloc(size_t nmemb, size_t size)
 
 void *memalign(size_t blocksize, size_t bytes)
 {
+    if (!ensure_init())
+        return bootstrap_alloc(bytes, blocksize);
+
+    uint64_t start = trace_fd >= 0 ? trace_now() : 0;
     void *ptr = myfn_memalign(blocksize, bytes);
+    if (hooked) {
+        if (trace_fd >= 0)
+            trace(ALLOC_TRACE_MEMALIGN, bytes, ptr, NULL, start);
+        note_alloc(ptr, bytes, 0);
+        return ptr;
+    }
 
     char buffer[70];
     int len=sprintf(buffer,"rMEMALING (%ld, %ld) @ %p\n",blocksize, bytes,ptr);
@@ -144,29 +1110,11 @@ void *memalign(size_t blocksize, size_t bytes)
 
 void *mmap(void *ptr,  size_t length, int prot, int flags, int fd, off_t offset)
 {
-  static int initializing = 0;
-  if (myfn_mmap == NULL) {
-    if (!initializing){
-      initializing = 1;
-      init();
-      initializing = 0;
-      fprintf(stdout, "rMMAP(%lu)\n", length);      
-      fprintf(stdout, "jcheck: allocated %lu bytes of temp memory in %lu chunks during initialization\n", tmppos, tmpallocs);
-    }
-    else {
-     if (tmppos + length < sizeof(tmpbuff)) {
-	void *retptr = tmpbuff + tmppos;
-	tmppos += length;
-	++tmpallocs;
-	return retptr;
-      }
-      else {
-	fprintf(stdout, "jcheck: too much memory requested during initialisation - increase tmpbuff size\n");
-	exit(1);
-      }
-    }
-  }
+  if (!ensure_init())
+    return (void *)syscall(SYS_mmap, ptr, length, prot, flags, fd, offset);
   void *ptr2 = myfn_mmap(ptr, length, prot, flags, fd, offset);
+  if (hooked)
+    return ptr2;
     
   char buffer[70];
   int len=sprintf(buffer,"rMMAP (%ld) at %p\n", length, ptr2);
@@ -177,6 +1125,11 @@ void *mmap(void *ptr,  size_t length, int prot, int flags, int fd, off_t offset)
 
 
 int munmap(void *ptr, size_t length){
+  if (!ensure_init())
+    return syscall(SYS_munmap, ptr, length);
+  if (hooked)
+    return myfn_munmap(ptr, length);
+
   char buffer[70];
   int len=sprintf(buffer,"rMUNMMAP-> (%p,%ld) => \n",ptr, length);
   write(1,buffer,len);
@@ -188,3 +1141,23 @@ int munmap(void *ptr, size_t length){
 
   return resp;
 }
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)))
+        return EINVAL;
+    void *ptr = memalign(alignment, size);
+    if (!ptr && size)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return memalign(alignment, size);
+}
@@ -1,189 +1,1365 @@
 #define _GNU_SOURCE
 #include "linked_list.h"
 
-pthread_rwlock_t lock;
+#include <errno.h>
+#include <unistd.h>
 
-/// @brief Initializes the list
-/// @param head list head
-void list_init(Node** head, size_t size) {
-    mem_init(size);
-    *head = NULL;
-    int init_result = pthread_rwlock_init(&lock, NULL);
+#include "rcu.h"
+#include "worker_pool.h"
+
+// State behind the Node** functions, its own head field is unused since the
+// caller owns the head
+static List legacy;
+
+#ifdef LIST_COMPACT_NODES
+typedef int32_t link_t;
+
+static inline Node* decode_link(const Node* node, link_t link) {
+    return link ? (Node*)((char*)node + link) : NULL;
+}
+
+static inline link_t encode_link(const Node* node, const Node* next) {
+    return next ? (link_t)((const char*)next - (const char*)node) : 0;
+}
+#else
+typedef Node* link_t;
+
+static inline Node* decode_link(const Node* node, link_t link) { return link; }
+
+static inline link_t encode_link(const Node* node, Node* next) { return next; }
+#endif
+
+/// @brief Next node as seen by a writer holding the lock, or by the owner of a
+/// node that is not published yet. Lock-free readers use list_next.
+static inline Node* next_of(const Node* node) {
+    return decode_link(node, node->next);
+}
+
+/// @brief Links a node that readers cannot see yet
+static inline void set_next(Node* node, Node* next) {
+    node->next = encode_link(node, next);
+}
+
+/// @brief Makes @p next reachable from @p node, the single store that
+/// publishes a change to lock-free readers
+static inline void publish_next(Node* node, Node* next) {
+    __atomic_store_n(&node->next, encode_link(node, next), __ATOMIC_RELEASE);
+}
+
+/// @brief Loads the first node so that it is fully initialized when read
+/// without the lock
+static inline Node* load_head(Node* const* head) {
+    return __atomic_load_n(head, __ATOMIC_ACQUIRE);
+}
+
+/// @brief Makes @p node the first node, see publish_next
+static inline void publish_head(Node** head, Node* node) {
+    __atomic_store_n(head, node, __ATOMIC_RELEASE);
+}
+
+/// @brief Whether @p head is the list's own head, in which case tail and count
+/// are maintained. Heads passed to the Node** functions are not tracked.
+static inline bool tracks(List* list, Node** head) {
+    return head == &list->head;
+}
+
+/// @brief Adjusts the node count, only called with the write lock held
+static inline void add_count(List* list, Node** head, long delta) {
+    if (tracks(list, head))
+        __atomic_store_n(&list->count, list->count + delta, __ATOMIC_RELAXED);
+}
+
+/// @brief Whether readers and writers share one mutual exclusion lock
+static inline bool exclusive(const List* list) {
+    return list->sync == LIST_SYNC_TICKET || list->sync == LIST_SYNC_ADAPTIVE;
+}
+
+/// @brief Lock implementation backing @p mode, for the list and its pool
+static mem_lock_kind lock_kind_of(list_sync_mode mode) {
+    switch (mode) {
+        case LIST_SYNC_TICKET:
+            return MEM_LOCK_TICKET;
+        case LIST_SYNC_ADAPTIVE:
+            return MEM_LOCK_ADAPTIVE;
+        default:
+            return MEM_LOCK_MUTEX;
+    }
+}
+
+/// @brief Readable name of @p mode
+const char* list_sync_name(list_sync_mode mode) {
+    switch (mode) {
+        case LIST_SYNC_RCU:
+            return "rcu";
+        case LIST_SYNC_TICKET:
+            return "ticket";
+        case LIST_SYNC_ADAPTIVE:
+            return "adaptive";
+        case LIST_SYNC_BRLOCK:
+            return "brlock";
+        default:
+            return "rwlock";
+    }
+}
+
+static inline void read_lock(List* list) {
+    if (list->sync == LIST_SYNC_RCU)
+        rcu_read_lock();
+    else if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_read_lock(&list->brlock);
+    else if (exclusive(list))
+        mem_lock_acquire(&list->mutex);
+    else
+        pthread_rwlock_rdlock(&list->lock);
+}
+
+static inline void read_unlock(List* list) {
+    if (list->sync == LIST_SYNC_RCU)
+        rcu_read_unlock();
+    else if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_read_unlock(&list->brlock);
+    else if (exclusive(list))
+        mem_lock_release(&list->mutex);
+    else
+        pthread_rwlock_unlock(&list->lock);
+}
+
+/// @brief Excludes readers, and other writers, in every mode but RCU where
+/// only writers are excluded
+static inline void write_lock(List* list) {
+    if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_write_lock(&list->brlock);
+    else if (exclusive(list))
+        mem_lock_acquire(&list->mutex);
+    else
+        pthread_rwlock_wrlock(&list->lock);
+}
+
+static inline void write_unlock(List* list) {
+    if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_write_unlock(&list->brlock);
+    else if (exclusive(list))
+        mem_lock_release(&list->mutex);
+    else
+        pthread_rwlock_unlock(&list->lock);
+}
+
+/// @brief Keeps writers out, in RCU mode as well, for scans that need the
+/// list and its segment marks to stay as they are
+static inline void scan_lock(List* list) {
+    if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_read_lock(&list->brlock);
+    else if (exclusive(list))
+        mem_lock_acquire(&list->mutex);
+    else
+        pthread_rwlock_rdlock(&list->lock);
+}
+
+static inline void scan_unlock(List* list) {
+    if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_read_unlock(&list->brlock);
+    else
+        write_unlock(list);
+}
+
+static void destroy_lock(List* list) {
+    if (list->sync == LIST_SYNC_BRLOCK)
+        brlock_destroy(&list->brlock);
+    else if (exclusive(list))
+        mem_lock_destroy(&list->mutex);
+    else
+        pthread_rwlock_destroy(&list->lock);
+}
+
+/// @brief Waits out a grace period and frees every retired node, must be
+/// called with the write lock held
+static void reclaim_retired(List* list) {
+    if (list->retired_count == 0) return;
+    rcu_synchronize();
+    for (size_t i = 0; i < list->retired_count; i++)
+        mem_pool_free(list->pool, list->retired[i]);
+    list->retired_count = 0;
+}
+
+/// @brief Frees an unlinked node, deferred until no reader can reach it in RCU
+/// mode. Must be called with the write lock held
+/// @param node node that is no longer reachable from the list
+static void retire_node(List* list, Node* node) {
+    if (list->sync != LIST_SYNC_RCU) {
+        mem_pool_free(list->pool, node);
+        return;
+    }
+    list->retired[list->retired_count++] = node;
+    if (list->retired_count == LIST_RCU_RETIRE_BATCH) reclaim_retired(list);
+}
+
+/// @brief Allocates a node, reclaiming retired nodes if the pool is full
+/// @return new node or NULL
+static Node* alloc_node(List* list) {
+    Node* node = mem_pool_alloc(list->pool, sizeof(Node));
+    if (!node && list->sync == LIST_SYNC_RCU) {
+        write_lock(list);
+        reclaim_retired(list);
+        write_unlock(list);
+        node = mem_pool_alloc(list->pool, sizeof(Node));
+    }
+    return node;
+}
+
+/// @brief Sets up everything but the pool
+static void init_state(List* list, list_sync_mode mode) {
+#ifdef LIST_COMPACT_NODES
+    if (list->pool->size > INT32_MAX) {
+        fprintf(stderr, "list pool too large for 32-bit node offsets\n");
+        exit(EXIT_FAILURE);
+    }
+#endif
+    list->head = NULL;
+    list->tail = NULL;
+    list->count = 0;
+    list->sync = mode;
+    list->retired_count = 0;
+    list->marks = NULL;
+    list->mark_count = 0;
+    list->mark_capacity = 0;
+    list->tail_run = 0;
+    if (exclusive(list)) {
+        mem_lock_init(&list->mutex, lock_kind_of(mode));
+        return;
+    }
+    if (mode == LIST_SYNC_BRLOCK) {
+        if (brlock_init(&list->brlock) != 0) {
+            perror("brlock_init failed");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    int init_result = pthread_rwlock_init(&list->lock, NULL);
     if (init_result != 0) {
         perror("pthread_rwlock_init failed");
         exit(EXIT_FAILURE);
     }
 }
 
-/// @brief inserts last in linked list
-/// @param head list head
-/// @param data data for the new node
-void list_insert(Node** head, uint16_t data) {
-    Node* new_node = mem_alloc(sizeof(Node));
-    if (!new_node) {
+/// @brief Adds a segment start after the existing ones
+/// @return false if the mark array could not grow
+static bool push_mark(List* list, Node* node) {
+    if (list->mark_count == list->mark_capacity) {
+        size_t capacity = list->mark_capacity ? 2 * list->mark_capacity : 16;
+        Node** grown = realloc(list->marks, capacity * sizeof(Node*));
+        if (!grown) return false;
+        list->marks = grown;
+        list->mark_capacity = capacity;
+    }
+    list->marks[list->mark_count++] = node;
+    return true;
+}
+
+/// @brief Accounts for nodes appended from @p first on, starting a new
+/// segment every LIST_SEGMENT_NODES nodes. Write lock held.
+static void note_appended(List* list, Node* first) {
+    for (Node* node = first; node != NULL; node = next_of(node)) {
+        if (list->tail_run >= LIST_SEGMENT_NODES && push_mark(list, node))
+            list->tail_run = 0;
+        list->tail_run++;
+    }
+}
+
+/// @brief Keeps the segment starts valid when @p node is unlinked, its
+/// successor takes over unless that already starts a segment. Write lock held.
+static void unmark(List* list, Node* node) {
+    for (size_t i = 0; i < list->mark_count; i++) {
+        if (list->marks[i] != node) continue;
+        Node* successor = next_of(node);
+        if (successor &&
+            (i + 1 == list->mark_count || list->marks[i + 1] != successor)) {
+            list->marks[i] = successor;
+        } else {
+            memmove(&list->marks[i], &list->marks[i + 1],
+                    (list->mark_count - i - 1) * sizeof(Node*));
+            list->mark_count--;
+        }
         return;
     }
-    new_node->data = data;
-    new_node->next = NULL;
-    pthread_rwlock_wrlock(&lock);
+}
+
+/// @brief Recomputes the tail and the segment starts after nodes were relinked
+/// wholesale. Write lock held.
+static void reindex(List* list) {
+    list->mark_count = 0;
+    list->tail_run = 0;
+    list->tail = NULL;
+    note_appended(list, list->head);
+    for (Node* node = list->head; node != NULL; node = next_of(node))
+        list->tail = node;
+}
+
+/// @brief Links the chain @p first .. @p last after the last node, must be
+/// called with the write lock held
+static void append_chain(List* list, Node** head, Node* first, Node* last) {
     if (*head == NULL) {
-        *head = new_node;
-        pthread_rwlock_unlock(&lock);
+        publish_head(head, first);
+    } else if (tracks(list, head)) {
+        publish_next(list->tail, first);
+    } else {
+        Node* walker = *head;
+        while (next_of(walker)) {
+            walker = next_of(walker);
+        }
+        publish_next(walker, first);
+    }
+    if (tracks(list, head)) {
+        list->tail = last;
+        note_appended(list, first);
+    }
+}
+
+static void insert_impl(List* list, Node** head, uint16_t data) {
+    Node* new_node = alloc_node(list);
+    if (!new_node) {
         return;
     }
-    Node* walker = *head;
-    while (walker->next) {
-        walker = walker->next;
+    new_node->data = data;
+    set_next(new_node, NULL);
+    write_lock(list);
+    append_chain(list, head, new_node, new_node);
+    add_count(list, head, 1);
+    write_unlock(list);
+}
+
+static size_t insert_bulk_impl(List* list, Node** head, const uint16_t* values,
+                               size_t n) {
+    if (n == 0) return 0;
+    Node** nodes = malloc(n * sizeof(Node*));
+    if (!nodes) return 0;
+    size_t allocated =
+        mem_pool_alloc_many(list->pool, sizeof(Node), n, (void**)nodes);
+    if (allocated < n && list->sync == LIST_SYNC_RCU) {
+        write_lock(list);
+        reclaim_retired(list);
+        write_unlock(list);
+        allocated += mem_pool_alloc_many(list->pool, sizeof(Node),
+                                         n - allocated,
+                                         (void**)nodes + allocated);
+    }
+    if (allocated == 0) {
+        free(nodes);
+        return 0;
     }
-    walker->next = new_node;
-    pthread_rwlock_unlock(&lock);
-    return;
+
+    // Link the new nodes privately, readers only see them once the chain is
+    // spliced in
+    for (size_t i = 0; i < allocated; i++) {
+        nodes[i]->data = values[i];
+        set_next(nodes[i], (i + 1 < allocated) ? nodes[i + 1] : NULL);
+    }
+    Node* first = nodes[0];
+    Node* last = nodes[allocated - 1];
+    free(nodes);
+
+    write_lock(list);
+    append_chain(list, head, first, last);
+    add_count(list, head, allocated);
+    write_unlock(list);
+    return allocated;
 }
 
-/// @brief Inserts a node after prev_node
-/// @param prev_nodenode that will be before new node
-/// @param data data for the new node
-void list_insert_after(Node* prev_node, uint16_t data) {
+static void insert_after_impl(List* list, Node** head, Node* prev_node,
+                              uint16_t data) {
     if (prev_node == NULL) return;
-    Node* new_node = mem_alloc(sizeof(Node));
+    Node* new_node = alloc_node(list);
     if (!new_node) return;
-    pthread_rwlock_wrlock(&lock);
-    new_node->next = prev_node->next;
     new_node->data = data;
-    prev_node->next = new_node;
-    pthread_rwlock_unlock(&lock);
+    write_lock(list);
+    set_next(new_node, next_of(prev_node));
+    publish_next(prev_node, new_node);
+    if (tracks(list, head) && list->tail == prev_node) {
+        list->tail = new_node;
+        note_appended(list, new_node);
+    }
+    add_count(list, head, 1);
+    write_unlock(list);
 }
 
-/// @brief inserts before a node
-/// @param head list head
-/// @param next_node node that will be after new node
-/// @param data data for the new node
-void list_insert_before(Node** head, Node* next_node, uint16_t data) {
-    pthread_rwlock_wrlock(&lock);
+static void insert_before_impl(List* list, Node** head, Node* next_node,
+                               uint16_t data) {
+    Node* new_node = alloc_node(list);
+    if (!new_node) return;
+    new_node->data = data;
+    set_next(new_node, next_node);
+    write_lock(list);
     if (*head == NULL) {
+        write_unlock(list);
+        mem_pool_free(list->pool, new_node);
         return;  // ERROR
-        pthread_rwlock_unlock(&lock);
-    }
-    Node* new_node = mem_alloc(sizeof(Node));
-    if (!new_node) {
-        pthread_rwlock_unlock(&lock);
-        return;
     }
 
     if (next_node == *head) {
-        new_node->data = data;
-        new_node->next = *head;
-        *head = new_node;
-        pthread_rwlock_unlock(&lock);
+        publish_head(head, new_node);
+        add_count(list, head, 1);
+        write_unlock(list);
         return;
     }
 
     Node* walker = *head;
-    while (walker->next != next_node && walker->next != NULL) {
-        walker = walker->next;
+    while (next_of(walker) != next_node && next_of(walker) != NULL) {
+        walker = next_of(walker);
     }
-    if (walker->next == NULL) {
-        pthread_rwlock_unlock(&lock);
-        mem_free(new_node);
+    if (next_of(walker) == NULL) {
+        write_unlock(list);
+        mem_pool_free(list->pool, new_node);
         return;  // ERRROR
     }
-    walker->next = new_node;
-    walker->next->next = next_node;
-    walker->next->data = data;
-    pthread_rwlock_unlock(&lock);
-    return;
+    publish_next(walker, new_node);
+    add_count(list, head, 1);
+    write_unlock(list);
 }
 
-/// @brief deletes the Node with data
-/// @param head list head
-/// @param data
-void list_delete(Node** head, uint16_t data) {
-    pthread_rwlock_wrlock(&lock);
-    if (*head == NULL){
-        pthread_rwlock_unlock(&lock);
+static void delete_impl(List* list, Node** head, uint16_t data) {
+    write_lock(list);
+    if (*head == NULL) {
+        write_unlock(list);
         return;
     }
-    if ((*head)->data == data) {
-        Node* temp = *head;
-        *head = (*head)->next;
-        mem_free(temp);
-        pthread_rwlock_unlock(&lock);
+    Node* prev = NULL;
+    Node* temp = *head;
+    while (temp != NULL && temp->data != data) {
+        prev = temp;
+        temp = next_of(temp);
+    }
+    if (temp == NULL) {
+        write_unlock(list);
         return;
     }
-    Node* walker = *head;
-    while (walker->next != NULL && walker->next->data != data) {
-        walker = walker->next;
+    if (prev)
+        publish_next(prev, next_of(temp));
+    else
+        publish_head(head, next_of(temp));
+    if (tracks(list, head)) {
+        if (list->tail == temp) list->tail = prev;
+        unmark(list, temp);
+        if (*head == NULL) {
+            list->mark_count = 0;
+            list->tail_run = 0;
+        }
     }
-    if (walker->next == NULL) {
-        pthread_rwlock_unlock(&lock);
-        return;
+    add_count(list, head, -1);
+    retire_node(list, temp);
+    write_unlock(list);
+}
+
+/// @brief Gives a batch of unlinked nodes back to the pool with a single
+/// mem_pool_free_many, after one grace period in RCU mode. Write lock held.
+static void free_unlinked(List* list, void** nodes, size_t n) {
+    if (n == 0) return;
+    if (list->sync == LIST_SYNC_RCU) rcu_synchronize();
+    mem_pool_free_many(list->pool, nodes, n);
+}
+
+static size_t delete_if_impl(List* list, Node** head, list_predicate pred,
+                             void* ctx) {
+    write_lock(list);
+    void** unlinked = NULL;
+    size_t unlinked_count = 0;
+    size_t capacity = 0;
+    size_t removed = 0;
+    Node* prev = NULL;
+    Node* node = *head;
+    while (node != NULL) {
+        // Unlinked nodes keep their link, RCU readers standing on one of
+        // them still get back into the list
+        Node* next = next_of(node);
+        if (!pred(node->data, ctx)) {
+            prev = node;
+            node = next;
+            continue;
+        }
+        if (prev)
+            publish_next(prev, next);
+        else
+            publish_head(head, next);
+        removed++;
+        if (unlinked_count == capacity) {
+            size_t grown_capacity = capacity ? 2 * capacity : 64;
+            void** grown = realloc(unlinked, grown_capacity * sizeof(void*));
+            if (grown) {
+                unlinked = grown;
+                capacity = grown_capacity;
+            }
+        }
+        if (unlinked_count < capacity)
+            unlinked[unlinked_count++] = node;
+        else
+            retire_node(list, node);
+        node = next;
+    }
+    if (removed > 0) {
+        if (tracks(list, head)) reindex(list);
+        add_count(list, head, -(long)removed);
+        free_unlinked(list, unlinked, unlinked_count);
     }
-    Node* temp = walker->next;
-    walker->next = temp->next;
-    mem_free(temp);
-    pthread_rwlock_unlock(&lock);
-    return;
+    write_unlock(list);
+    free(unlinked);
+    return removed;
 }
 
-/// @brief return the pointer to node with data or NULL if not found
-/// @param head list head
-/// @param data value to search for
-/// @return Node* or NULL if node not found
-Node* list_search(Node** head, uint16_t data) {
-    pthread_rwlock_rdlock(&lock);
+static int equals_value(uint16_t data, void* ctx) {
+    return data == *(const uint16_t*)ctx;
+}
+
+static void insert_sorted_impl(List* list, Node** head, uint16_t data) {
+    Node* new_node = alloc_node(list);
+    if (!new_node) return;
+    new_node->data = data;
+    write_lock(list);
+    // After any equal values, so repeated inserts keep their order
+    Node* prev = NULL;
     Node* walker = *head;
+    while (walker != NULL && walker->data <= data) {
+        prev = walker;
+        walker = next_of(walker);
+    }
+    set_next(new_node, walker);
+    if (prev)
+        publish_next(prev, new_node);
+    else
+        publish_head(head, new_node);
+    if (tracks(list, head) && walker == NULL) {
+        list->tail = new_node;
+        note_appended(list, new_node);
+    }
+    add_count(list, head, 1);
+    write_unlock(list);
+}
+
+/// @brief Merges two sorted chains by relinking their nodes, taking from @p a
+/// on ties so the merge is stable
+/// @return first node of the merged chain
+static Node* merge_chains(Node* a, Node* b) {
+    Node* first = NULL;
+    Node* last = NULL;
+    while (a && b) {
+        Node** from = (b->data < a->data) ? &b : &a;
+        Node* node = *from;
+        *from = next_of(node);
+        if (last)
+            set_next(last, node);
+        else
+            first = node;
+        last = node;
+    }
+    Node* rest = a ? a : b;
+    if (last)
+        set_next(last, rest);
+    else
+        first = rest;
+    return first;
+}
+
+/// @brief Stable bottom-up merge sort of a chain. Runs of 2^i nodes wait in
+/// bins[i] and are merged like carries in a binary counter, so the only extra
+/// memory is the fixed array on the stack.
+/// @return first node of the sorted chain
+static Node* sort_chain(Node* chain) {
+    Node* bins[64] = {NULL};
+    size_t used = 0;
+    while (chain) {
+        Node* run = chain;
+        chain = next_of(chain);
+        set_next(run, NULL);
+        size_t i = 0;
+        for (; i < used && bins[i]; i++) {
+            run = merge_chains(bins[i], run);
+            bins[i] = NULL;
+        }
+        if (i == used) used++;
+        bins[i] = run;
+    }
+    Node* sorted = NULL;
+    for (size_t i = 0; i < used; i++) {
+        if (bins[i]) sorted = sorted ? merge_chains(bins[i], sorted) : bins[i];
+    }
+    return sorted;
+}
+
+/// @brief Gives back the nodes of a chain that readers can no longer reach,
+/// see retire_node. Write lock held.
+static void retire_chain(List* list, Node* chain) {
+    while (chain) {
+        Node* next = next_of(chain);
+        retire_node(list, chain);
+        chain = next;
+    }
+}
+
+/// @brief Takes the chain of @p head to be relinked. Lock-free readers could
+/// follow links while they change, so in RCU mode the chain is copied into new
+/// nodes and the readers stay on the old ones until relinked_chain publishes
+/// the copy. Write lock held.
+/// @param chain receives the chain to relink
+/// @return false, with @p head untouched, if the pool has no room for a copy
+static bool detach_chain(List* list, Node** head, Node** chain) {
+    *chain = *head;
+    if (list->sync != LIST_SYNC_RCU) return true;
+    Node *first = NULL, *last = NULL;
+    for (Node* node = *head; node; node = next_of(node)) {
+        Node* copy = mem_pool_alloc(list->pool, sizeof(Node));
+        if (!copy) {
+            reclaim_retired(list);
+            copy = mem_pool_alloc(list->pool, sizeof(Node));
+        }
+        if (!copy) {
+            // never published, no reader can be on them
+            while (first) {
+                Node* next = next_of(first);
+                mem_pool_free(list->pool, first);
+                first = next;
+            }
+            return false;
+        }
+        copy->data = node->data;
+        set_next(copy, NULL);
+        if (last)
+            set_next(last, copy);
+        else
+            first = copy;
+        last = copy;
+    }
+    *chain = first;
+    return true;
+}
+
+/// @brief Publishes a relinked chain as the content of @p head with one
+/// pointer swap, in RCU mode the old nodes are retired. Write lock held.
+static void relinked_chain(List* list, Node** head, Node* chain) {
+    Node* old = *head;
+    publish_head(head, chain);
+    if (list->sync == LIST_SYNC_RCU) retire_chain(list, old);
+    if (tracks(list, head)) reindex(list);
+}
+
+static void sort_impl(List* list, Node** head) {
+    write_lock(list);
+    Node* chain;
+    if (detach_chain(list, head, &chain))
+        relinked_chain(list, head, sort_chain(chain));
+    write_unlock(list);
+}
+
+/// @brief Stores @p values in the nodes @p blocks and links them in that order
+/// @return first node of the chain
+static Node* build_chain(void** blocks, const uint16_t* values, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        Node* node = blocks[i];
+        node->data = values[i];
+        set_next(node, i + 1 < n ? blocks[i + 1] : NULL);
+    }
+    return n ? blocks[0] : NULL;
+}
+
+/// @brief RCU half of compact_impl. Readers may still be on the old nodes, so
+/// the copy goes into free memory, is published with one pointer swap and the
+/// old nodes are freed after a grace period. Write lock held.
+/// @return @p n, or 0 if the pool had no room for a second copy
+static size_t compact_copy(List* list, Node** head, void** old_nodes,
+                           const uint16_t* values, size_t n) {
+    reclaim_retired(list);
+    void** fresh = malloc(n * sizeof(void*));
+    size_t allocated =
+        fresh ? mem_pool_alloc_many(list->pool, sizeof(Node), n, fresh) : 0;
+    if (allocated < n) {
+        mem_pool_free_many(list->pool, fresh, allocated);
+        free(fresh);
+        return 0;
+    }
+    publish_head(head, build_chain(fresh, values, n));
+    rcu_synchronize();
+    mem_pool_free_many(list->pool, old_nodes, n);
+    free(fresh);
+    return n;
+}
+
+static size_t compact_impl(List* list, Node** head) {
+    write_lock(list);
+    size_t n = 0;
+    for (Node* node = *head; node != NULL; node = next_of(node)) n++;
+    void** nodes = malloc(n * sizeof(void*));
+    uint16_t* values = malloc(n * sizeof(uint16_t));
+    size_t moved = 0;
+    if (n > 0 && nodes && values) {
+        size_t i = 0;
+        for (Node* node = *head; node != NULL; node = next_of(node)) {
+            nodes[i] = node;
+            values[i++] = node->data;
+        }
+        if (list->sync == LIST_SYNC_RCU) {
+            moved = compact_copy(list, head, nodes, values, n);
+        } else {
+            // No reader can see the list, so the old nodes are given up first
+            // and the new ones packed into the coalesced space. n freed nodes
+            // always leave room for n new ones.
+            moved = mem_pool_repack(list->pool, nodes, n, sizeof(Node));
+            publish_head(head, build_chain(nodes, values, moved));
+            add_count(list, head, (long)moved - (long)n);
+        }
+        if (moved > 0 && tracks(list, head)) reindex(list);
+    }
+    write_unlock(list);
+    free(nodes);
+    free(values);
+    return moved;
+}
+
+static Node* search_impl(List* list, Node** head, uint16_t data) {
+    read_lock(list);
+    Node* walker = load_head(head);
     while (walker != NULL) {
         if (walker->data == data) {
-            pthread_rwlock_unlock(&lock);
+            read_unlock(list);
             return walker;
         }
-        walker = walker->next;
+        walker = list_next(walker);
     }
-    pthread_rwlock_unlock(&lock);
+    read_unlock(list);
     return NULL;
 }
 
+/// @brief Copies the values of the range into a new array, holding the read
+/// lock only while copying
+/// @param count receives the number of values
+/// @return malloc'd array the caller frees, NULL with errno ENOMEM if it could
+/// not be allocated
+static uint16_t* snapshot_range(List* list, Node** head, Node* start_node,
+                                Node* end_node, size_t* count) {
+    size_t capacity = 64;
+    uint16_t* values = malloc(capacity * sizeof(uint16_t));
+    size_t n = 0;
+    read_lock(list);
+    if (end_node) end_node = list_next(end_node);
+    if (!start_node) start_node = load_head(head);
+    while (values && start_node != NULL && start_node != end_node) {
+        if (n == capacity) {
+            capacity *= 2;
+            uint16_t* grown = realloc(values, capacity * sizeof(uint16_t));
+            if (!grown) {
+                free(values);
+                values = NULL;
+                break;
+            }
+            values = grown;
+        }
+        values[n++] = start_node->data;
+        start_node = list_next(start_node);
+    }
+    read_unlock(list);
+    *count = values ? n : 0;
+    if (!values) errno = ENOMEM;
+    return values;
+}
+
+/// @brief Room needed to format @p n values as "[v, v, ...]" including the
+/// terminating NUL
+static inline size_t formatted_size(size_t n) {
+    return 2 + n * (5 + 2) + 1;
+}
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+/// @brief Writes the decimal digits of @p value without going through stdio
+/// @return position after the last digit
+static inline char* format_u16(char* out, uint16_t value) {
+    char digits[5];
+    char* p = digits + sizeof(digits);
+    while (value >= 100) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * (value % 100), 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * value, 2);
+    } else {
+        *--p = '0' + value;
+    }
+    size_t len = digits + sizeof(digits) - p;
+    memcpy(out, p, len);
+    return out + len;
+}
+
+/// @brief Formats @p values as "[v, v, ...]" into @p out, which must have room
+/// for formatted_size(n) bytes
+/// @return length of the text, excluding the terminating NUL
+static size_t format_values(const uint16_t* values, size_t n, char* out) {
+    char* p = out;
+    *p++ = '[';
+    for (size_t i = 0; i < n; i++) {
+        if (i) {
+            *p++ = ',';
+            *p++ = ' ';
+        }
+        p = format_u16(p, values[i]);
+    }
+    *p++ = ']';
+    *p = '\0';
+    return p - out;
+}
+
+/// @brief Snapshots and formats the range into a new buffer
+/// @param len receives the length of the text
+/// @return malloc'd text the caller frees, NULL with errno ENOMEM if out of
+/// memory
+static char* format_range_alloc(List* list, Node** head, Node* start_node,
+                                Node* end_node, size_t* len) {
+    size_t n;
+    uint16_t* values = snapshot_range(list, head, start_node, end_node, &n);
+    if (!values) return NULL;
+    char* text = malloc(formatted_size(n));
+    if (text) *len = format_values(values, n, text);
+    free(values);
+    return text;
+}
+
+static size_t format_range_impl(List* list, Node** head, Node* start_node,
+                                Node* end_node, char* buf, size_t size) {
+    size_t len = 0;
+    char* text = format_range_alloc(list, head, start_node, end_node, &len);
+    if (!text) {
+        if (size > 0) buf[0] = '\0';
+        return 0;
+    }
+    if (size > 0) {
+        size_t copied = len < size - 1 ? len : size - 1;
+        memcpy(buf, text, copied);
+        buf[copied] = '\0';
+    }
+    free(text);
+    return len;
+}
+
+static ssize_t display_range_fd_impl(List* list, Node** head, Node* start_node,
+                                     Node* end_node, int fd) {
+    size_t len = 0;
+    char* text = format_range_alloc(list, head, start_node, end_node, &len);
+    if (!text) return -1;
+    size_t written = 0;
+    while (written < len) {
+        ssize_t result = write(fd, text + written, len - written);
+        if (result < 0 && errno == EINTR) continue;
+        if (result < 0) {
+            free(text);
+            return -1;
+        }
+        written += result;
+    }
+    free(text);
+    return written;
+}
+
+static void display_range_impl(List* list, Node** head, Node* start_node,
+                               Node* end_node) {
+    size_t len = 0;
+    char* text = format_range_alloc(list, head, start_node, end_node, &len);
+    if (!text) return;
+    // One stdio call keeps the output ordered with the caller's printf output
+    fwrite(text, 1, len, stdout);
+    free(text);
+}
+
+/// @brief Opens a read view of the list behind @p head and prefetches the
+/// first nodes
+static void iter_open(list_iter* it, List* list, Node** head) {
+    read_lock(list);
+    it->list = list;
+    it->current = load_head(head);
+    it->ahead = it->current;
+    for (int i = 0; i < LIST_ITER_PREFETCH && it->ahead; i++) {
+        it->ahead = list_next(it->ahead);
+        __builtin_prefetch(it->ahead);  // never faults, not even on NULL
+    }
+}
+
+/// @brief Steps the iterator, keeping the prefetch window LIST_ITER_PREFETCH
+/// nodes ahead
+/// @return the node stepped over, NULL at the end
+static inline Node* iter_advance(list_iter* it) {
+    Node* node = it->current;
+    if (!node) return NULL;
+    it->current = list_next(node);
+    if (it->ahead) {
+        it->ahead = list_next(it->ahead);
+        __builtin_prefetch(it->ahead);
+    }
+    return node;
+}
+
+/// @brief Initializes the list
+/// @param head list head
+void list_init(Node** head, size_t size) {
+    list_init_sync(head, size, LIST_SYNC_RWLOCK);
+}
+
+/// @brief Initializes the list with the given reader/writer synchronization
+/// @param head list head
+/// @param size bytes available for nodes
+/// @param mode LIST_SYNC_RCU for read-mostly lists
+void list_init_sync(Node** head, size_t size, list_sync_mode mode) {
+    mem_init_lock(size, lock_kind_of(mode));
+    *head = NULL;
+    legacy.pool = mem_default_pool();
+    init_state(&legacy, mode);
+}
+
+/// @brief inserts last in linked list
+/// @param head list head
+/// @param data data for the new node
+void list_insert(Node** head, uint16_t data) {
+    insert_impl(&legacy, head, data);
+}
+
+/// @brief Appends @p n values in order, allocating all nodes in one batch and
+/// taking the lock once
+/// @param head list head
+/// @param values data for the new nodes
+/// @param n number of values
+/// @return number of values inserted, less than @p n if the memory ran out
+size_t list_insert_bulk(Node** head, const uint16_t* values, size_t n) {
+    return insert_bulk_impl(&legacy, head, values, n);
+}
+
+/// @brief Inserts a node after prev_node
+/// @param prev_nodenode that will be before new node
+/// @param data data for the new node
+void list_insert_after(Node* prev_node, uint16_t data) {
+    insert_after_impl(&legacy, NULL, prev_node, data);
+}
+
+/// @brief inserts before a node
+/// @param head list head
+/// @param next_node node that will be after new node
+/// @param data data for the new node
+void list_insert_before(Node** head, Node* next_node, uint16_t data) {
+    insert_before_impl(&legacy, head, next_node, data);
+}
+
+/// @brief deletes the Node with data
+/// @param head list head
+/// @param data
+void list_delete(Node** head, uint16_t data) {
+    delete_impl(&legacy, head, data);
+}
+
+/// @brief Deletes every node for which @p pred returns nonzero in a single
+/// traversal under one write lock, the nodes go back to the memory manager in
+/// one batch
+/// @param head list head
+/// @param pred called once per node, in list order
+/// @param ctx passed to @p pred
+/// @return number of nodes deleted
+size_t list_delete_if(Node** head, list_predicate pred, void* ctx) {
+    return delete_if_impl(&legacy, head, pred, ctx);
+}
+
+/// @brief Deletes every node holding @p value, see list_delete_if
+/// @return number of nodes deleted
+size_t list_delete_all(Node** head, uint16_t value) {
+    return delete_if_impl(&legacy, head, equals_value, &value);
+}
+
+/// @brief Inserts @p data after the last node that is not greater, keeping a
+/// sorted list sorted with one walk and one lock acquisition
+/// @param head list head
+/// @param data data for the new node
+void list_insert_sorted(Node** head, uint16_t data) {
+    insert_sorted_impl(&legacy, head, data);
+}
+
+/// @brief Merges the sorted list @p b into the sorted list @p a by relinking
+/// the existing nodes, @p b is left empty. Equal values from @p a come first.
+/// In RCU mode readers keep seeing the old lists until the merged copy is
+/// published; both lists are left as they are if the pool has no room for it.
+/// @param a list head that receives all nodes
+/// @param b list head that is emptied
+void list_merge(Node** a, Node** b) {
+    if (a == b) return;
+    write_lock(&legacy);
+    Node *chain_a, *chain_b;
+    if (detach_chain(&legacy, a, &chain_a)) {
+        if (detach_chain(&legacy, b, &chain_b)) {
+            // a first: a reader may see a value in both lists for a moment,
+            // but never in neither
+            relinked_chain(&legacy, a, merge_chains(chain_a, chain_b));
+            relinked_chain(&legacy, b, NULL);
+        } else if (chain_a != *a) {
+            retire_chain(&legacy, chain_a);  // the unpublished copy
+        }
+    }
+    write_unlock(&legacy);
+}
+
+/// @brief Sorts the list in place with a stable bottom-up merge sort, nothing
+/// is allocated from the pool. In RCU mode a sorted copy is published instead,
+/// and the list is left unsorted if the pool has no room for it.
+/// @param head list head
+void list_sort(Node** head) { sort_impl(&legacy, head); }
+
+/// @brief Moves the nodes into the lowest free memory of the pool, adjacent
+/// and in list order, so that traversals walk memory forward. In rwlock mode
+/// node pointers obtained before the call are invalid afterwards. In RCU mode
+/// the nodes are copied, which needs room for a second copy of the list, and
+/// the old ones are freed after a grace period.
+/// @param head list head
+/// @return number of nodes moved, 0 if nothing was moved
+size_t list_compact(Node** head) { return compact_impl(&legacy, head); }
+
+/// @brief return the pointer to node with data or NULL if not found
+/// @param head list head
+/// @param data value to search for
+/// @return Node* or NULL if node not found
+Node* list_search(Node** head, uint16_t data) {
+    return search_impl(&legacy, head, data);
+}
+
 /// @brief displays all nodes
 /// @param head list head
 void list_display(Node** head) { list_display_range(head, NULL, NULL); }
 
-/// @brief Displays the nodes in the range, including start and end
+/// @brief Displays the nodes in the range, including start and end. Displays
+/// nothing and sets errno to ENOMEM if the values cannot be copied.
 /// @param head list head
 /// @param start_node first node to display
 /// @param end_node last node to display
 void list_display_range(Node** head, Node* start_node, Node* end_node) {
-    pthread_rwlock_rdlock(&lock);
-    if (end_node) end_node = end_node->next;
-    if (!start_node) start_node = *head;
-    printf("[");
-    while (start_node != NULL && start_node != end_node) {
-        printf("%d", start_node->data);
-        start_node = start_node->next;
-        if (start_node && start_node != end_node) printf(", ");
-    }
-    printf("]");
-    pthread_rwlock_unlock(&lock);
+    display_range_impl(&legacy, head, start_node, end_node);
+}
+
+/// @brief Formats the nodes in the range like list_display_range into @p buf.
+/// The values are copied under the read lock and formatted after releasing it.
+/// @param head list head
+/// @param start_node first node, NULL for the head
+/// @param end_node last node, NULL for the end of the list
+/// @param buf receives at most @p size - 1 characters and a NUL
+/// @param size size of @p buf
+/// @return length of the full text, larger than @p size - 1 if it was cut, 0
+/// with an empty @p buf and errno ENOMEM if the values cannot be copied
+size_t list_format_range(Node** head, Node* start_node, Node* end_node,
+                         char* buf, size_t size) {
+    return format_range_impl(&legacy, head, start_node, end_node, buf, size);
+}
+
+/// @brief Displays the nodes in the range on @p fd with a single write call
+/// @param head list head
+/// @param start_node first node to display
+/// @param end_node last node to display
+/// @param fd file descriptor to write to
+/// @return bytes written or -1 on error
+ssize_t list_display_range_fd(Node** head, Node* start_node, Node* end_node,
+                              int fd) {
+    return display_range_fd_impl(&legacy, head, start_node, end_node, fd);
 }
 
 /// @brief returns the number of nodes
 /// @param head list head
 /// @return int
 int list_count_nodes(Node** head) {
-    pthread_rwlock_rdlock(&lock);
-    Node* walker = *head;
+    read_lock(&legacy);
+    Node* walker = load_head(head);
     int counter = 0;
     while (walker != NULL) {
         counter++;
-        walker = walker->next;
+        walker = list_next(walker);
     }
-    pthread_rwlock_unlock(&lock);
+    read_unlock(&legacy);
     return counter;
 }
 
+/// @brief Opens a read view of the list, see list_iter
+/// @param it iterator to open
+/// @param head list head
+void list_iter_begin(list_iter* it, Node** head) {
+    iter_open(it, &legacy, head);
+}
+
+/// @brief Returns the next node of the view, NULL at the end. The node stays
+/// valid until list_iter_end.
+Node* list_iter_next(list_iter* it) { return iter_advance(it); }
+
+/// @brief Copies the data of up to @p n next nodes into @p values
+/// @return number of values copied, less than @p n only at the end
+size_t list_iter_next_batch(list_iter* it, uint16_t* values, size_t n) {
+    size_t filled = 0;
+    Node* node;
+    while (filled < n && (node = iter_advance(it)) != NULL)
+        values[filled++] = node->data;
+    return filled;
+}
+
+/// @brief Closes the read view, must run on the thread that opened it
+void list_iter_end(list_iter* it) {
+    read_unlock(it->list);
+    it->list = NULL;
+    it->current = it->ahead = NULL;
+}
+
 /// @brief frees all used memory
 /// @param head list head
 void list_cleanup(Node** head) {
+    write_lock(&legacy);
+    reclaim_retired(&legacy);
+    write_unlock(&legacy);
     *head = NULL;
     mem_deinit();
-    pthread_rwlock_destroy(&lock);
-}
\ No newline at end of file
+    destroy_lock(&legacy);
+}
+
+/// @brief Initializes @p list with its own pool of @p size bytes
+/// @param list list to initialize
+/// @param size bytes available for nodes
+/// @param mode reader/writer synchronization of this list
+void list_h_init(List* list, size_t size, list_sync_mode mode) {
+    mem_pool_init_lock(&list->own_pool, size, lock_kind_of(mode));
+    list->pool = &list->own_pool;
+    init_state(list, mode);
+}
+
+/// @brief Inserts last in @p list in constant time
+/// @param list list to insert into
+/// @param data data for the new node
+void list_h_insert(List* list, uint16_t data) {
+    insert_impl(list, &list->head, data);
+}
+
+/// @brief Appends @p n values in order, allocating all nodes in one batch and
+/// taking the lock once
+/// @param list list to insert into
+/// @param values data for the new nodes
+/// @param n number of values
+/// @return number of values inserted, less than @p n if the pool ran out
+size_t list_h_insert_bulk(List* list, const uint16_t* values, size_t n) {
+    return insert_bulk_impl(list, &list->head, values, n);
+}
+
+/// @brief Inserts a node after @p prev_node, which must belong to @p list
+/// @param list list @p prev_node belongs to
+/// @param prev_node node that will be before new node
+/// @param data data for the new node
+void list_h_insert_after(List* list, Node* prev_node, uint16_t data) {
+    insert_after_impl(list, &list->head, prev_node, data);
+}
+
+/// @brief Inserts before @p next_node
+/// @param list list @p next_node belongs to
+/// @param next_node node that will be after new node
+/// @param data data for the new node
+void list_h_insert_before(List* list, Node* next_node, uint16_t data) {
+    insert_before_impl(list, &list->head, next_node, data);
+}
+
+/// @brief Deletes the first node with @p data
+/// @param list list to delete from
+/// @param data
+void list_h_delete(List* list, uint16_t data) {
+    delete_impl(list, &list->head, data);
+}
+
+/// @brief Deletes every node of @p list for which @p pred returns nonzero, see
+/// list_delete_if
+/// @return number of nodes deleted
+size_t list_h_delete_if(List* list, list_predicate pred, void* ctx) {
+    return delete_if_impl(list, &list->head, pred, ctx);
+}
+
+/// @brief Deletes every node of @p list holding @p value
+/// @return number of nodes deleted
+size_t list_h_delete_all(List* list, uint16_t value) {
+    return delete_if_impl(list, &list->head, equals_value, &value);
+}
+
+/// @brief Inserts @p data after the last node that is not greater
+/// @param list sorted list to insert into
+/// @param data data for the new node
+void list_h_insert_sorted(List* list, uint16_t data) {
+    insert_sorted_impl(list, &list->head, data);
+}
+
+/// @brief Sorts @p list in place with a stable bottom-up merge sort, nothing is
+/// allocated from the pool, see list_sort for RCU mode
+void list_h_sort(List* list) { sort_impl(list, &list->head); }
+
+/// @brief Moves the nodes of @p list into the lowest free memory of its pool
+/// in list order, see list_compact
+/// @return number of nodes moved, 0 if nothing was moved
+size_t list_h_compact(List* list) { return compact_impl(list, &list->head); }
+
+/// @brief return the pointer to node with data or NULL if not found
+/// @param list list to search
+/// @param data value to search for
+/// @return Node* or NULL if node not found
+Node* list_h_search(List* list, uint16_t data) {
+    return search_impl(list, &list->head, data);
+}
+
+/// @brief displays all nodes of @p list
+void list_h_display(List* list) { list_h_display_range(list, NULL, NULL); }
+
+/// @brief Displays the nodes in the range, including start and end, like
+/// list_display_range
+/// @param list list the nodes belong to
+/// @param start_node first node to display, NULL for the head
+/// @param end_node last node to display, NULL for the tail
+void list_h_display_range(List* list, Node* start_node, Node* end_node) {
+    display_range_impl(list, &list->head, start_node, end_node);
+}
+
+/// @brief Same as list_format_range on @p list
+size_t list_h_format_range(List* list, Node* start_node, Node* end_node,
+                           char* buf, size_t size) {
+    return format_range_impl(list, &list->head, start_node, end_node, buf,
+                             size);
+}
+
+/// @brief Same as list_display_range_fd on @p list
+ssize_t list_h_display_range_fd(List* list, Node* start_node, Node* end_node,
+                                int fd) {
+    return display_range_fd_impl(list, &list->head, start_node, end_node, fd);
+}
+
+/// @brief Opens a read view of @p list, see list_iter
+void list_h_iter_begin(list_iter* it, List* list) {
+    iter_open(it, list, &list->head);
+}
+
+/// @brief returns the number of nodes without walking or locking the list
+/// @param list list to count
+/// @return size_t
+size_t list_h_count_nodes(List* list) {
+    return __atomic_load_n(&list->count, __ATOMIC_RELAXED);
+}
+
+/// @brief frees all memory used by @p list
+/// @param list list to clean up, unusable until initialized again
+void list_h_cleanup(List* list) {
+    write_lock(list);
+    reclaim_retired(list);
+    write_unlock(list);
+    list->head = NULL;
+    list->tail = NULL;
+    list->count = 0;
+    free(list->marks);
+    list->marks = NULL;
+    list->mark_count = 0;
+    list->mark_capacity = 0;
+    mem_pool_deinit(list->pool);
+    destroy_lock(list);
+}
+
+/// Shared state of one parallel scan, segment i runs from segment_start(i) up
+/// to but not including segment_end(i)
+typedef struct {
+    Node* head;
+    Node** marks;
+    size_t segments;
+    uint16_t data;
+    size_t found_segment;  // lowest segment with a match so far
+    Node** found;          // first match of every segment
+    list_aggregate* partial;
+} parallel_scan;
+
+static inline Node* segment_start(parallel_scan* scan, size_t i) {
+    return i ? scan->marks[i - 1] : scan->head;
+}
+
+static inline Node* segment_end(parallel_scan* scan, size_t i) {
+    return i + 1 < scan->segments ? scan->marks[i] : NULL;
+}
+
+static void aggregate_segment(void* arg, size_t i) {
+    parallel_scan* scan = arg;
+    list_aggregate result = {.count = 0, .sum = 0, .min = UINT16_MAX, .max = 0};
+    Node* end = segment_end(scan, i);
+    for (Node* node = segment_start(scan, i); node != end;
+         node = next_of(node)) {
+        result.count++;
+        result.sum += node->data;
+        if (node->data < result.min) result.min = node->data;
+        if (node->data > result.max) result.max = node->data;
+    }
+    scan->partial[i] = result;
+}
+
+static void search_segment(void* arg, size_t i) {
+    parallel_scan* scan = arg;
+    Node* end = segment_end(scan, i);
+    size_t visited = 0;
+    scan->found[i] = NULL;
+    for (Node* node = segment_start(scan, i); node != end;
+         node = next_of(node)) {
+        if (node->data == scan->data) {
+            scan->found[i] = node;
+            size_t lowest = __atomic_load_n(&scan->found_segment, __ATOMIC_RELAXED);
+            while (i < lowest &&
+                   !__atomic_compare_exchange_n(&scan->found_segment, &lowest, i,
+                                                false, __ATOMIC_RELAXED,
+                                                __ATOMIC_RELAXED)) {
+            }
+            return;
+        }
+        // A match in an earlier segment makes the rest of this one irrelevant
+        if ((++visited & 255) == 0 &&
+            __atomic_load_n(&scan->found_segment, __ATOMIC_RELAXED) < i)
+            return;
+    }
+}
+
+/// @brief Finds the first node with @p data, scanning the segments of @p list
+/// on the worker pool. Writers are held off for the duration of the scan, also
+/// in RCU mode, so the segment starts stay valid.
+/// @param list list to search
+/// @param data value to search for
+/// @return Node* or NULL if node not found
+Node* list_h_search_parallel(List* list, uint16_t data) {
+    scan_lock(list);
+    parallel_scan scan = {.head = list->head,
+                          .marks = list->marks,
+                          .segments = list->mark_count + 1,
+                          .data = data,
+                          .found_segment = SIZE_MAX};
+    scan.found = malloc(scan.segments * sizeof(Node*));
+    Node* result = NULL;
+    if (scan.head && scan.found) {
+        worker_pool_run(scan.segments, search_segment, &scan);
+        if (scan.found_segment != SIZE_MAX)
+            result = scan.found[scan.found_segment];
+    }
+    free(scan.found);
+    scan_unlock(list);
+    return result;
+}
+
+/// @brief Counts the nodes of @p list and sums, minimizes and maximizes their
+/// values, scanning its segments on the worker pool. Writers are held off for
+/// the duration of the scan.
+/// @param list list to scan
+/// @return list_aggregate, all zero count if @p list is empty
+list_aggregate list_h_aggregate_parallel(List* list) {
+    list_aggregate total = {.count = 0, .sum = 0, .min = UINT16_MAX, .max = 0};
+    scan_lock(list);
+    parallel_scan scan = {.head = list->head,
+                          .marks = list->marks,
+                          .segments = list->mark_count + 1};
+    scan.partial = malloc(scan.segments * sizeof(list_aggregate));
+    if (scan.head && scan.partial) {
+        worker_pool_run(scan.segments, aggregate_segment, &scan);
+        for (size_t i = 0; i < scan.segments; i++) {
+            total.count += scan.partial[i].count;
+            total.sum += scan.partial[i].sum;
+            if (scan.partial[i].min < total.min) total.min = scan.partial[i].min;
+            if (scan.partial[i].max > total.max) total.max = scan.partial[i].max;
+        }
+    }
+    free(scan.partial);
+    scan_unlock(list);
+    return total;
+}
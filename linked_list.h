@@ -5,29 +5,171 @@
 #include <pthread.h>
 #include <stdint.h>
 #include <math.h>
+#include <sys/types.h>
 
+#include "brlock.h"
 #include "memory_manager.h"  // Include your custom memory manager
 
 
+#ifdef LIST_COMPACT_NODES
+/// Compact layout, 8 bytes per node instead of 16. Every node of a list lives
+/// in the same pool, so the link is a 32-bit byte offset from the node to the
+/// next one, which limits a list's pool to 2 GiB.
+typedef struct Node {
+    uint16_t data;  // Stores the data as an unsigned 16-bit integer
+    int32_t next;   // Offset from this node to the next, 0 ends the list
+} Node;
+
+/// @brief Returns the node after @p node, NULL at the end of the list
+static inline Node *list_next(const Node *node) {
+    int32_t offset = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    return offset ? (Node *)((char *)node + offset) : NULL;
+}
+#else
 typedef struct Node {
     uint16_t data;      // Stores the data as an unsigned 16-bit integer
     struct Node *next;  // Pointer to the next node in the list
-    pthread_mutex_t lock;
-
 } Node;
 
+/// @brief Returns the node after @p node, NULL at the end of the list
+static inline Node *list_next(const Node *node) {
+    return __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+}
+#endif
+
+/// How readers and writers of the list are synchronized
+typedef enum {
+    LIST_SYNC_RWLOCK,  // readers and writers share a pthread rwlock
+    LIST_SYNC_RCU,     // readers take no lock, writers publish with a pointer
+                       // swap and free unlinked nodes after a grace period
+    LIST_SYNC_TICKET,  // readers and writers take one ticket lock, the node
+                       // pool of a handle uses one as well
+    LIST_SYNC_ADAPTIVE,  // same with a spin-then-futex lock, see mem_lock
+    LIST_SYNC_BRLOCK     // readers only touch a per-thread slot, writers wait
+                         // for every slot to drain, see brlock
+} list_sync_mode;
+
+/// Number of unlinked nodes a writer collects in RCU mode before it waits for
+/// a grace period and gives them back to the memory manager
+#define LIST_RCU_RETIRE_BATCH 64
+
+/// @brief A list instance with its own lock, node pool, head, tail and count.
+/// Lists set up with list_h_init share no state with each other or with the
+/// Node** functions, so a process can spread its data over many of them.
+/// The lock, which every reader writes to in rwlock mode, and the state
+/// writers change each get their own cache line, apart from the fields that
+/// are only read after init.
+typedef struct List {
+    list_sync_mode sync;
+    mem_pool *pool;  // own_pool, or the default pool for the Node** functions
+    union {
+        pthread_rwlock_t lock __attribute__((aligned(MEM_CACHE_LINE)));
+        mem_lock mutex;  // LIST_SYNC_TICKET and LIST_SYNC_ADAPTIVE
+        brlock brlock;   // LIST_SYNC_BRLOCK
+    };
+    Node *head __attribute__((aligned(MEM_CACHE_LINE)));
+    Node *tail;
+    size_t count;  // maintained by writers, readable without the lock
+    size_t retired_count;
+    Node **marks;  // first node of every segment after the first, in list order
+    size_t mark_count;
+    size_t mark_capacity;
+    size_t tail_run;  // nodes appended since the last segment started
+    // unlinked nodes waiting for a grace period
+    Node *retired[LIST_RCU_RETIRE_BATCH];
+    mem_pool own_pool;
+} List;
+
+/// Appends start a new segment for the parallel scans every this many nodes
+#define LIST_SEGMENT_NODES 1024
+
+/// Result of list_h_aggregate_parallel, min is UINT16_MAX and max 0 for an
+/// empty list
+typedef struct {
+    size_t count;
+    uint64_t sum;
+    uint16_t min;
+    uint16_t max;
+} list_aggregate;
+
+/// Nodes an iterator runs ahead of the node it returns, each one is prefetched
+/// when the iterator reaches it
+#define LIST_ITER_PREFETCH 4
+
+/// @brief A read view of a list opened by list_iter_begin or list_h_iter_begin
+/// and closed by list_iter_end on the same thread. While it is open, writers
+/// wait for it in the lock modes, and in RCU mode deleted nodes are not freed,
+/// so the iterating thread must not modify the list before closing it.
+typedef struct {
+    List *list;
+    Node *current;  // node the next call returns
+    Node *ahead;    // LIST_ITER_PREFETCH nodes past current, NULL near the end
+} list_iter;
+
+/// Predicate for list_delete_if, a nonzero result deletes the node holding
+/// @p data
+typedef int (*list_predicate)(uint16_t data, void *ctx);
+
 // Function declarations
 void list_init(Node **head, size_t size);
+void list_init_sync(Node **head, size_t size, list_sync_mode mode);
+const char *list_sync_name(list_sync_mode mode);
 void list_insert(Node **head, uint16_t data);
+size_t list_insert_bulk(Node **head, const uint16_t *values, size_t n);
 void list_insert_after(Node *prev_node, uint16_t data);
 void list_insert_before(Node **head, Node *next_node, uint16_t data);
 void list_delete(Node **head, uint16_t data);
+size_t list_delete_if(Node **head, list_predicate pred, void *ctx);
+size_t list_delete_all(Node **head, uint16_t value);
 Node *list_search(Node **head, uint16_t data);
 
+void list_insert_sorted(Node **head, uint16_t data);
+void list_merge(Node **a, Node **b);
+void list_sort(Node **head);
+size_t list_compact(Node **head);
+
 void list_display(Node **head);
 void list_display_range(Node **head, Node *start_node, Node *end_node);
+ssize_t list_display_range_fd(Node **head, Node *start_node, Node *end_node,
+                              int fd);
+size_t list_format_range(Node **head, Node *start_node, Node *end_node,
+                         char *buf, size_t size);
+
+void list_iter_begin(list_iter *it, Node **head);
+Node *list_iter_next(list_iter *it);
+size_t list_iter_next_batch(list_iter *it, uint16_t *values, size_t n);
+void list_iter_end(list_iter *it);
 
 int list_count_nodes(Node **head);
 void list_cleanup(Node **head);
 
+// Functions on List instances
+void list_h_init(List *list, size_t size, list_sync_mode mode);
+void list_h_insert(List *list, uint16_t data);
+size_t list_h_insert_bulk(List *list, const uint16_t *values, size_t n);
+void list_h_insert_after(List *list, Node *prev_node, uint16_t data);
+void list_h_insert_before(List *list, Node *next_node, uint16_t data);
+void list_h_delete(List *list, uint16_t data);
+size_t list_h_delete_if(List *list, list_predicate pred, void *ctx);
+size_t list_h_delete_all(List *list, uint16_t value);
+Node *list_h_search(List *list, uint16_t data);
+
+void list_h_insert_sorted(List *list, uint16_t data);
+void list_h_sort(List *list);
+size_t list_h_compact(List *list);
+
+void list_h_display(List *list);
+void list_h_display_range(List *list, Node *start_node, Node *end_node);
+ssize_t list_h_display_range_fd(List *list, Node *start_node, Node *end_node,
+                                int fd);
+size_t list_h_format_range(List *list, Node *start_node, Node *end_node,
+                           char *buf, size_t size);
+
+void list_h_iter_begin(list_iter *it, List *list);
+
+size_t list_h_count_nodes(List *list);
+Node *list_h_search_parallel(List *list, uint16_t data);
+list_aggregate list_h_aggregate_parallel(List *list);
+void list_h_cleanup(List *list);
+
 #endif  // LINKED_LIST_H
\ No newline at end of file
@@ -0,0 +1,144 @@
+#define _GNU_SOURCE
+#include "locks.h"
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// @brief Tells the CPU the thread is spinning, which frees execution
+/// resources for a sibling hyperthread
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/// @brief Whether spinning can pay off, with a single CPU the holder cannot
+/// run while the waiter spins
+static bool spinning_useful(void) {
+    static int cpus = 0;
+    int n = __atomic_load_n(&cpus, __ATOMIC_RELAXED);
+    if (n == 0) {
+        n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (n < 1) n = 1;
+        __atomic_store_n(&cpus, n, __ATOMIC_RELAXED);
+    }
+    return n > 1;
+}
+
+static void futex_wait(uint32_t *word, uint32_t expected) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake_one(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/// @brief Initializes @p lock as a lock of @p kind
+void mem_lock_init(mem_lock *lock, mem_lock_kind kind) {
+    lock->kind = kind;
+    switch (kind) {
+        case MEM_LOCK_TICKET:
+            lock->ticket.next = 0;
+            lock->ticket.serving = 0;
+            break;
+        case MEM_LOCK_ADAPTIVE:
+            lock->state = 0;
+            break;
+        default:
+            lock->kind = MEM_LOCK_MUTEX;
+            pthread_mutex_init(&lock->mutex, NULL);
+            break;
+    }
+}
+
+static void ticket_acquire(mem_lock *lock) {
+    uint32_t ticket =
+        __atomic_fetch_add(&lock->ticket.next, 1, __ATOMIC_RELAXED);
+    unsigned spins = spinning_useful() ? 0 : MEM_LOCK_SPINS;
+    while (__atomic_load_n(&lock->ticket.serving, __ATOMIC_ACQUIRE) != ticket) {
+        if (spins < MEM_LOCK_SPINS) {
+            spins++;
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+/// @brief Three-state futex lock: waiters that give up spinning mark the lock
+/// contended, so an uncontended release never enters the kernel
+static void adaptive_acquire(mem_lock *lock) {
+    uint32_t expected = 0;
+    if (spinning_useful()) {
+        for (unsigned i = 0; i < MEM_LOCK_SPINS; i++) {
+            expected = 0;
+            if (__atomic_load_n(&lock->state, __ATOMIC_RELAXED) == 0 &&
+                __atomic_compare_exchange_n(&lock->state, &expected, 1, false,
+                                            __ATOMIC_ACQUIRE,
+                                            __ATOMIC_RELAXED))
+                return;
+            cpu_relax();
+        }
+    } else {
+        if (__atomic_compare_exchange_n(&lock->state, &expected, 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return;
+    }
+    while (__atomic_exchange_n(&lock->state, 2, __ATOMIC_ACQUIRE) != 0)
+        futex_wait(&lock->state, 2);
+}
+
+/// @brief Waits until @p lock is held by the caller
+void mem_lock_acquire(mem_lock *lock) {
+    switch (lock->kind) {
+        case MEM_LOCK_TICKET:
+            ticket_acquire(lock);
+            break;
+        case MEM_LOCK_ADAPTIVE:
+            adaptive_acquire(lock);
+            break;
+        default:
+            pthread_mutex_lock(&lock->mutex);
+            break;
+    }
+}
+
+/// @brief Releases @p lock, held by the caller
+void mem_lock_release(mem_lock *lock) {
+    switch (lock->kind) {
+        case MEM_LOCK_TICKET:
+            // Only the holder writes serving
+            __atomic_store_n(&lock->ticket.serving, lock->ticket.serving + 1,
+                             __ATOMIC_RELEASE);
+            break;
+        case MEM_LOCK_ADAPTIVE:
+            if (__atomic_exchange_n(&lock->state, 0, __ATOMIC_RELEASE) == 2)
+                futex_wake_one(&lock->state);
+            break;
+        default:
+            pthread_mutex_unlock(&lock->mutex);
+            break;
+    }
+}
+
+/// @brief Destroys @p lock, which must not be held
+void mem_lock_destroy(mem_lock *lock) {
+    if (lock->kind == MEM_LOCK_MUTEX) pthread_mutex_destroy(&lock->mutex);
+}
+
+/// @brief Readable name of @p kind
+const char *mem_lock_name(mem_lock_kind kind) {
+    switch (kind) {
+        case MEM_LOCK_TICKET:
+            return "ticket";
+        case MEM_LOCK_ADAPTIVE:
+            return "adaptive";
+        default:
+            return "mutex";
+    }
+}
@@ -0,0 +1,47 @@
+// locks.h
+#ifndef LOCKS_H
+#define LOCKS_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+/// Lock implementations a mem_lock can use
+typedef enum {
+    MEM_LOCK_MUTEX,    // pthread mutex
+    MEM_LOCK_TICKET,   // FIFO ticket lock, waiters spin and yield
+    MEM_LOCK_ADAPTIVE  // spins briefly, then sleeps on a futex
+} mem_lock_kind;
+
+/// Times an adaptive lock retries before it sleeps, and a ticket lock waiter
+/// spins before it starts yielding the CPU
+#define MEM_LOCK_SPINS 128
+
+/// @brief A mutual exclusion lock whose implementation is picked at init
+typedef struct mem_lock {
+    mem_lock_kind kind;
+    union {
+        pthread_mutex_t mutex;
+        struct {
+            uint32_t next;     // ticket handed to the next arriving thread
+            uint32_t serving;  // ticket allowed in
+        } ticket;
+        uint32_t state;  // adaptive: 0 free, 1 held, 2 held with sleepers
+    };
+} mem_lock;
+
+/// @brief Initializes @p lock as a lock of @p kind
+void mem_lock_init(mem_lock *lock, mem_lock_kind kind);
+
+/// @brief Waits until @p lock is held by the caller
+void mem_lock_acquire(mem_lock *lock);
+
+/// @brief Releases @p lock, held by the caller
+void mem_lock_release(mem_lock *lock);
+
+/// @brief Destroys @p lock, which must not be held
+void mem_lock_destroy(mem_lock *lock);
+
+/// @brief Readable name of @p kind
+const char *mem_lock_name(mem_lock_kind kind);
+
+#endif  // LOCKS_H
@@ -1,6 +1,14 @@
 #define _GNU_SOURCE
 #include "memory_manager.h"
 
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// From linux/mempolicy.h, numaif.h is not always installed
+#define MEM_MPOL_PREFERRED 1
+
 typedef struct memory_block {
     void *start;
     void *end;
@@ -15,144 +23,439 @@ memory_block *memory_block_factory(void *start, void *end, memory_block *next) {
     return new_block;
 }
 
-pthread_mutex_t allocation_lock;
+/// A free range of a pool's memory, a node of a treap ordered by address with
+/// every subtree annotated with the largest range in it
+typedef struct free_range {
+    void *start;
+    void *end;
+    memory_block *before;  // block right before the range, NULL at the start
+    size_t max_gap;        // largest range in this subtree
+    uint32_t priority;     // heap order of the treap
+    struct free_range *left;
+    struct free_range *right;
+} free_range;
 
-memory_block *head;
-void *memory_;
-size_t size_;
+/// @brief Heap priority of a range starting at @p start. Hashing the address
+/// keeps the treap balanced in expectation without shared random state.
+static inline uint32_t range_priority(void *start) {
+    uint64_t x = (uintptr_t)start;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
 
-/// @brief Initiates the memory mannager with @p size bytes of memory
-/// @param size bytes that will be available in the memory manager
-void mem_init(size_t size) {
-    head = NULL;
-    memory_ = malloc(size);
-    size_ = size;
-    pthread_mutex_init(&allocation_lock, NULL);
+static inline size_t range_size(const free_range *range) {
+    return range->end - range->start;
 }
 
-/// @brief Allocates @p size bytes of memory
-/// @param @p size number of bytes that will be allocated
-/// @return pointer to the allocated memory
-void *mem_alloc(size_t size) {
-    if (size > size_) return NULL;
-    if (size == 0) return memory_;
-    pthread_mutex_lock(&allocation_lock);
-
-    // Insertion first
-    if (head == NULL || head->start - memory_ >= size) {
-        memory_block *new_block =
-            memory_block_factory(memory_, memory_ + size, head);
-        head = new_block;
-        pthread_mutex_unlock(&allocation_lock);
-        return memory_;
-    }
-
-    // Insertion between blocks or last
-    memory_block *walker = head;
-    while (walker != NULL) {
-        size_t space = (walker->next) ? walker->next->start - walker->end
-                                      : memory_ + size_ - walker->end;
-        if (space >= size) {
-            memory_block *new_block = memory_block_factory(
-                walker->end, walker->end + size, walker->next);
-            walker->next = new_block;
-            void *ret_val = walker->end;
-            pthread_mutex_unlock(&allocation_lock);
-            return ret_val;
-        }
-        walker = walker->next;
+static inline size_t subtree_gap(const free_range *range) {
+    return range ? range->max_gap : 0;
+}
+
+static inline void range_update(free_range *range) {
+    size_t gap = range_size(range);
+    if (subtree_gap(range->left) > gap) gap = subtree_gap(range->left);
+    if (subtree_gap(range->right) > gap) gap = subtree_gap(range->right);
+    range->max_gap = gap;
+}
+
+/// @brief Splits @p tree into the ranges starting below @p key and the rest
+static void range_split(free_range *tree, void *key, free_range **below,
+                        free_range **rest) {
+    if (!tree) {
+        *below = *rest = NULL;
+    } else if (tree->start < key) {
+        range_split(tree->right, key, &tree->right, rest);
+        range_update(tree);
+        *below = tree;
+    } else {
+        range_split(tree->left, key, below, &tree->left);
+        range_update(tree);
+        *rest = tree;
+    }
+}
+
+/// @brief Joins two treaps where every range of @p low comes before @p high
+static free_range *range_join(free_range *low, free_range *high) {
+    if (!low) return high;
+    if (!high) return low;
+    if (low->priority > high->priority) {
+        low->right = range_join(low->right, high);
+        range_update(low);
+        return low;
+    }
+    high->left = range_join(low, high->left);
+    range_update(high);
+    return high;
+}
+
+static free_range *range_insert(free_range *tree, free_range *range) {
+    if (!tree) return range;
+    if (range->priority > tree->priority) {
+        range_split(tree, range->start, &range->left, &range->right);
+        range_update(range);
+        return range;
+    }
+    if (range->start < tree->start)
+        tree->left = range_insert(tree->left, range);
+    else
+        tree->right = range_insert(tree->right, range);
+    range_update(tree);
+    return tree;
+}
+
+/// @brief Takes the range starting at @p start out of @p tree
+/// @param removed receives the range, untouched if there is none
+static free_range *range_remove(free_range *tree, void *start,
+                                free_range **removed) {
+    if (!tree) return NULL;
+    if (start < tree->start) {
+        tree->left = range_remove(tree->left, start, removed);
+    } else if (start > tree->start) {
+        tree->right = range_remove(tree->right, start, removed);
+    } else {
+        *removed = tree;
+        return range_join(tree->left, tree->right);
+    }
+    range_update(tree);
+    return tree;
+}
+
+/// @brief Lowest addressed range of at least @p size bytes, found by only
+/// descending into subtrees whose largest range fits
+static free_range *range_first_fit(free_range *tree, size_t size) {
+    if (subtree_gap(tree) < size) return NULL;
+    for (;;) {
+        if (subtree_gap(tree->left) >= size)
+            tree = tree->left;
+        else if (range_size(tree) >= size)
+            return tree;
+        else
+            tree = tree->right;
+    }
+}
+
+/// @brief Range holding the address @p at, NULL if it is allocated
+static free_range *range_containing(free_range *tree, void *at) {
+    while (tree) {
+        if (at < tree->start)
+            tree = tree->left;
+        else if (at >= tree->end)
+            tree = tree->right;
+        else
+            return tree;
     }
-    pthread_mutex_unlock(&allocation_lock);
     return NULL;
 }
 
-/// @brief A nolock copy of the mem_alloc function that can be used for alloc
-/// when a lock has already been aquired
+static void range_destroy(free_range *tree) {
+    if (!tree) return;
+    range_destroy(tree->left);
+    range_destroy(tree->right);
+    free(tree);
+}
+
+/// @brief Sets @p range to [@p start, @p end) after @p before and adds it to
+/// the pool, allocating a node if @p range is NULL
+static void add_range(mem_pool *pool, free_range *range, void *start,
+                      void *end, memory_block *before) {
+    if (!range) range = malloc(sizeof(*range));
+    range->start = start;
+    range->end = end;
+    range->before = before;
+    range->priority = range_priority(start);
+    range->left = range->right = NULL;
+    range->max_gap = end - start;
+    pool->free_ranges = range_insert(pool->free_ranges, range);
+}
+
+/// @brief Sets up the free ranges of a pool whose memory is all free
+static void init_ranges(mem_pool *pool) {
+    pool->free_ranges = NULL;
+    if (pool->memory && pool->size > 0)
+        add_range(pool, NULL, pool->memory, pool->memory + pool->size, NULL);
+}
+
+/// @brief Allocates [@p start, @p start + @p size) out of the free range
+/// @p range, linking its block into the block list right after the block
+/// that precedes the range. Allocation lock held.
+/// @return @p start
+static void *take_range(mem_pool *pool, free_range *range, void *start,
+                        size_t size) {
+    void *end = start + size;
+    void *range_start = range->start;
+    void *range_end = range->end;
+    memory_block *before = range->before;
+    memory_block *block = memory_block_factory(
+        start, end, before ? before->next : pool->head);
+    if (before)
+        before->next = block;
+    else
+        pool->head = block;
+
+    free_range *removed = NULL;
+    pool->free_ranges = range_remove(pool->free_ranges, range_start, &removed);
+    if (range_start < start) {
+        add_range(pool, removed, range_start, start, before);
+        removed = NULL;
+    }
+    if (end < range_end) {
+        add_range(pool, removed, end, range_end, block);
+        removed = NULL;
+    }
+    free(removed);
+    return start;
+}
+
+/// @brief Unlinks @p block, which follows @p prev in the block list, frees it
+/// and merges its memory with the free ranges next to it. Allocation lock
+/// held.
+static void release_block(mem_pool *pool, memory_block *prev,
+                          memory_block *block) {
+    void *start = block->start;
+    void *end = block->end;
+    memory_block *next = block->next;
+    if (prev)
+        prev->next = next;
+    else
+        pool->head = next;
+    free(block);
+
+    void *lower = prev ? prev->end : pool->memory;
+    void *upper = next ? next->start : pool->memory + pool->size;
+    free_range *range = NULL;
+    free_range *after = NULL;
+    if (lower < start)
+        pool->free_ranges = range_remove(pool->free_ranges, lower, &range);
+    if (end < upper)
+        pool->free_ranges = range_remove(pool->free_ranges, end, &after);
+    free(after);
+    add_range(pool, range, lower, upper, prev);
+}
+
+mem_pool default_pool;
+
+/// @brief The pool used by mem_init, mem_alloc, mem_free, mem_resize and
+/// mem_deinit
+mem_pool *mem_default_pool() { return &default_pool; }
+
+/// @brief Initiates @p pool with @p size bytes of memory
+/// @param pool pool to initiate
+/// @param size bytes that will be available in the pool
+void mem_pool_init(mem_pool *pool, size_t size) {
+    mem_pool_init_lock(pool, size, MEM_LOCK_MUTEX);
+}
+
+/// @brief Initiates @p pool with @p size bytes of memory, guarded by a lock of
+/// @p kind
+/// @param pool pool to initiate
+/// @param size bytes that will be available in the pool
+/// @param kind implementation of the allocation lock
+void mem_pool_init_lock(mem_pool *pool, size_t size, mem_lock_kind kind) {
+    pool->head = NULL;
+    pool->memory = malloc(size);
+    pool->size = size;
+    pool->mapped = false;
+    init_ranges(pool);
+    mem_lock_init(&pool->allocation_lock, kind);
+}
+
+/// @brief Initiates @p pool with @p size bytes of memory placed on NUMA node
+/// @p node. The memory is mapped separately and given a preferred-node policy
+/// before it is touched, so its pages are faulted in on that node.
+/// @param pool pool to initiate
+/// @param size bytes that will be available in the pool
+/// @param node NUMA node to place the memory on
+/// @return 0 if the memory is bound to @p node, -1 if it could not be (no
+/// such node, or no NUMA support), the pool is usable either way
+int mem_pool_init_node(mem_pool *pool, size_t size, int node) {
+    void *memory = (size > 0 && node >= 0)
+                       ? mmap(NULL, size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                       : MAP_FAILED;
+    if (memory == MAP_FAILED) {
+        mem_pool_init(pool, size);
+        return -1;
+    }
+    pool->head = NULL;
+    pool->memory = memory;
+    pool->size = size;
+    pool->mapped = true;
+    init_ranges(pool);
+    mem_lock_init(&pool->allocation_lock, MEM_LOCK_MUTEX);
+
+    unsigned long bits = 8 * sizeof(unsigned long);
+    unsigned long mask[(node / bits) + 1];
+    memset(mask, 0, sizeof(mask));
+    mask[node / bits] = 1UL << (node % bits);
+#ifdef SYS_mbind
+    if (syscall(SYS_mbind, memory, size, MEM_MPOL_PREFERRED, mask,
+                (unsigned long)node + 2, 0) == 0)
+        return 0;
+#endif
+    return -1;
+}
+
+/// @brief Allocates from @p pool, must be called with the allocation lock held.
+/// The lowest addressed gap that fits is found in O(log n) through the free
+/// range tree, and an allocation that cannot fit fails in O(1).
+/// @param pool pool to allocate from
 /// @param size bytes that should be allocated
 /// @return pointer to allocated memory
-void *mem_alloc__nolock__(size_t size) {
-    if (size > size_) return NULL;
-    if (size == 0) return memory_;
+static void *pool_alloc_nolock(mem_pool *pool, size_t size) {
+    free_range *range = range_first_fit(pool->free_ranges, size);
+    if (!range) return NULL;
+    return take_range(pool, range, range->start, size);
+}
 
-    // insertion first
-    if (head == NULL || head->start - memory_ >= size) {
-        memory_block *new_block =
-            memory_block_factory(memory_, memory_ + size, head);
-        head = new_block;
-        return memory_;
+/// @brief Allocates @p size bytes of memory from @p pool
+/// @param pool pool to allocate from
+/// @param size number of bytes that will be allocated
+/// @return pointer to the allocated memory or NULL
+void *mem_pool_alloc(mem_pool *pool, size_t size) {
+    if (size > pool->size) return NULL;
+    if (size == 0) return pool->memory;
+    mem_lock_acquire(&pool->allocation_lock);
+    void *ret_val = pool_alloc_nolock(pool, size);
+    mem_lock_release(&pool->allocation_lock);
+    return ret_val;
+}
+
+/// @brief Allocates up to @p n blocks of @p size bytes, must be called with the
+/// allocation lock held
+/// @return number of blocks allocated
+static size_t pool_alloc_many_nolock(mem_pool *pool, size_t size, size_t n,
+                                     void **blocks) {
+    size_t allocated = 0;
+    while (allocated < n) {
+        void *block = pool_alloc_nolock(pool, size);
+        if (!block) break;
+        blocks[allocated++] = block;
     }
+    return allocated;
+}
 
-    // Insertion between blocks or last
-    memory_block *walker = head;
-    while (walker != NULL) {
-        size_t available_space = (walker->next)
-                                     ? walker->next->start - walker->end
-                                     : memory_ + size_ - walker->end;
-        if (available_space >= size) {
-            memory_block *new_block = memory_block_factory(
-                walker->end, walker->end + size, walker->next);
-            walker->next = new_block;
-            walker->next = new_block;
-            void *ret_val = walker->end;
-            return ret_val;
-        }
-        walker = walker->next;
+/// @brief Allocates up to @p n blocks of @p size bytes from @p pool with a
+/// single lock acquisition. Blocks land where
+/// repeated mem_pool_alloc calls would have put them.
+/// @param pool pool to allocate from
+/// @param size bytes per block
+/// @param n number of blocks wanted
+/// @param blocks receives the allocated blocks, must have room for @p n
+/// @return number of blocks allocated, less than @p n if the pool ran out
+size_t mem_pool_alloc_many(mem_pool *pool, size_t size, size_t n,
+                           void **blocks) {
+    if (size > pool->size) return 0;
+    if (size == 0) {
+        for (size_t i = 0; i < n; i++) blocks[i] = pool->memory;
+        return n;
     }
-    return NULL;
+    mem_lock_acquire(&pool->allocation_lock);
+    size_t allocated = pool_alloc_many_nolock(pool, size, n, blocks);
+    mem_lock_release(&pool->allocation_lock);
+    return allocated;
 }
 
-/// @brief Frees @p block preventing memory leaks
+/// @brief Frees @p block that was allocated from @p pool
+/// @param pool pool the block belongs to
 /// @param block
-void mem_free(void *block) {
-    pthread_mutex_lock(&allocation_lock);
-    // No nodes
-    if (!head) {
-        pthread_mutex_unlock(&allocation_lock);
-        return;
-    }
-    // block is first, change head
-    if (head->start == block) {
-        memory_block *temp = head;
-        head = head->next;
-        free(temp);
-        pthread_mutex_unlock(&allocation_lock);
-        return;
-    }
-    // block is not first, find block
-    memory_block *walker = head;
-    while (walker->next != NULL) {
-        if (walker->next->start == block) {
-            memory_block *temp = walker->next;
-            walker->next = temp->next;
-            free(temp);
-            pthread_mutex_unlock(&allocation_lock);
-            return;
-        }
+void mem_pool_free(mem_pool *pool, void *block) {
+    mem_lock_acquire(&pool->allocation_lock);
+    memory_block *prev = NULL;
+    memory_block *walker = pool->head;
+    while (walker != NULL && walker->start != block) {
+        prev = walker;
         walker = walker->next;
     }
-    pthread_mutex_unlock(&allocation_lock);
-    return;
+    if (walker) release_block(pool, prev, walker);
+    mem_lock_release(&pool->allocation_lock);
+}
+
+static int compare_addresses(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t) * (void *const *)a;
+    uintptr_t y = (uintptr_t) * (void *const *)b;
+    return (x > y) - (x < y);
 }
+
+/// @brief Frees the blocks of the address-sorted array @p blocks in one walk of
+/// the block list, must be called with the allocation lock held
+static void pool_free_sorted_nolock(mem_pool *pool, void **blocks, size_t n) {
+    // The block list is sorted by address as well, so each block is found by
+    // moving forward from where the previous one was
+    memory_block *prev = NULL;
+    memory_block *walker = pool->head;
+    size_t i = 0;
+    while (walker != NULL && i < n) {
+        if (walker->start < blocks[i]) {
+            prev = walker;
+            walker = walker->next;
+            continue;
+        }
+        if (walker->start == blocks[i]) {
+            memory_block *next = walker->next;
+            release_block(pool, prev, walker);
+            walker = next;
+        }
+        i++;
+    }
+}
+
+/// @brief Frees @p n blocks that were allocated from @p pool in one walk of the
+/// block list. Sorts @p blocks by address.
+/// @param pool pool the blocks belong to
+/// @param blocks blocks to free, pointers that are not allocated are ignored
+/// @param n number of blocks
+void mem_pool_free_many(mem_pool *pool, void **blocks, size_t n) {
+    if (n == 0) return;
+    qsort(blocks, n, sizeof(void *), compare_addresses);
+    mem_lock_acquire(&pool->allocation_lock);
+    pool_free_sorted_nolock(pool, blocks, n);
+    mem_lock_release(&pool->allocation_lock);
+}
+
+/// @brief Frees @p n blocks and allocates @p n blocks of @p size bytes in their
+/// place under one lock acquisition, so no other allocation can take the
+/// freed space in between. The new blocks are handed out first-fit in address
+/// order, which packs them into the lowest gaps once the old ones coalesced.
+/// Contents are not preserved.
+/// @param pool pool the blocks belong to
+/// @param blocks blocks to free, receives the new blocks in address order
+/// @param n number of blocks
+/// @param size bytes per new block, no larger than the freed blocks
+/// @return number of new blocks, @p n unless some of @p blocks were not
+/// allocated or @p size is larger than they were
+size_t mem_pool_repack(mem_pool *pool, void **blocks, size_t n, size_t size) {
+    if (n == 0) return 0;
+    qsort(blocks, n, sizeof(void *), compare_addresses);
+    mem_lock_acquire(&pool->allocation_lock);
+    pool_free_sorted_nolock(pool, blocks, n);
+    size_t allocated = pool_alloc_many_nolock(pool, size, n, blocks);
+    mem_lock_release(&pool->allocation_lock);
+    return allocated;
+}
+
 /// @brief Changes the size of the allocated block, return NULL if failed
+/// @param pool pool the block belongs to
 /// @param block pointer to your allocated memory, if NULL allocates new memory
 /// of @p size
 /// @param size The new size of your allocated memory, if 0 mem_free is called
 /// for @p block
 /// @return
-void *mem_resize(void *block, size_t size) {
+void *mem_pool_resize(mem_pool *pool, void *block, size_t size) {
     // Edge cases
-    if (size > size_) return NULL;
-    if (!block) return mem_alloc(size);
+    if (size > pool->size) return NULL;
+    if (!block) return mem_pool_alloc(pool, size);
     if (size == 0) {
-        mem_free(block);
+        mem_pool_free(pool, block);
         return NULL;
     }
-    pthread_mutex_lock(&allocation_lock);
+    mem_lock_acquire(&pool->allocation_lock);
 
     // Find the node and the previous node incase we want to replace the old one
     // after bypass
     memory_block *before_node = NULL;
-    memory_block *node = head;
+    memory_block *node = pool->head;
     while (node != NULL && node->start != block) {
         before_node = node;
         node = node->next;
@@ -160,48 +463,116 @@ void *mem_resize(void *block, size_t size) {
 
     // invalid block, return
     if (!node) {
-        pthread_mutex_unlock(&allocation_lock);
+        mem_lock_release(&pool->allocation_lock);
         return NULL;
     }
 
-    // Bypass old node so mem_alloc can properly return a new block
-    if (before_node)
-        before_node->next = node->next;
-    else
-        head = head->next;
+    // Give the old block up first so that the new one can overlap it, as if
+    // it had been freed and allocated again
+    size_t old_size = node->end - node->start;
+    release_block(pool, before_node, node);
 
     // get new block
-    void *newblock = mem_alloc__nolock__(size);
+    void *newblock = pool_alloc_nolock(pool, size);
 
-    // if allocation failed replace the old node and return NULL
+    // if allocation failed take the old block back, its contents are intact
     if (!newblock) {
-        if (before_node)
-            before_node->next = node;
-        else
-            head = node;
-        pthread_mutex_unlock(&allocation_lock);
+        take_range(pool, range_containing(pool->free_ranges, block), block,
+                   old_size);
+        mem_lock_release(&pool->allocation_lock);
         return NULL;
     }
 
-    // Free old block no longer in use and copy over memory to new block, then
-    // return new block
-    size_t old_size = node->end - node->start;
-    free(node);
-    memcpy(newblock, block, (old_size < size) ? old_size : size);
-    pthread_mutex_unlock(&allocation_lock);
+    // copy over memory to new block, then return new block
+    memmove(newblock, block, (old_size < size) ? old_size : size);
+    mem_lock_release(&pool->allocation_lock);
     return newblock;
 }
 
-/// @brief gives back the memory used by the memory manager
-void mem_deinit() {
-    memory_block *walker = head;
+/// @brief Gives back the memory used by @p pool
+/// @param pool pool to deinit, unusable until initiated again
+void mem_pool_deinit(mem_pool *pool) {
+    memory_block *walker = pool->head;
     while (walker != NULL) {
         memory_block *temp = walker;
         walker = walker->next;
         free(temp);
     }
-    free(memory_);
-    size_ = 0;
-    head = NULL;
-    pthread_mutex_destroy(&allocation_lock);
+    range_destroy(pool->free_ranges);
+    pool->free_ranges = NULL;
+    if (pool->mapped)
+        munmap(pool->memory, pool->size);
+    else
+        free(pool->memory);
+    pool->size = 0;
+    pool->head = NULL;
+    mem_lock_destroy(&pool->allocation_lock);
+}
+
+/// @brief Size of the largest free gap in @p pool, the largest block an
+/// allocation can currently get. Constant time.
+/// @param pool pool to look at
+/// @return bytes in the largest gap
+size_t mem_pool_largest_free(mem_pool *pool) {
+    mem_lock_acquire(&pool->allocation_lock);
+    size_t largest = subtree_gap(pool->free_ranges);
+    mem_lock_release(&pool->allocation_lock);
+    return largest;
+}
+
+/// @brief Initiates the memory mannager with @p size bytes of memory
+/// @param size bytes that will be available in the memory manager
+void mem_init(size_t size) { mem_pool_init(&default_pool, size); }
+
+/// @brief Initiates the memory mannager with @p size bytes of memory, guarded
+/// by a lock of @p kind
+void mem_init_lock(size_t size, mem_lock_kind kind) {
+    mem_pool_init_lock(&default_pool, size, kind);
+}
+
+/// @brief Allocates @p size bytes of memory
+/// @param @p size number of bytes that will be allocated
+/// @return pointer to the allocated memory
+void *mem_alloc(size_t size) { return mem_pool_alloc(&default_pool, size); }
+
+/// @brief Allocates up to @p n blocks of @p size bytes each while taking the
+/// allocation lock once
+/// @param blocks receives the allocated blocks, must have room for @p n
+/// @return number of blocks allocated, less than @p n if the memory ran out
+size_t mem_alloc_many(size_t size, size_t n, void **blocks) {
+    return mem_pool_alloc_many(&default_pool, size, n, blocks);
 }
+
+/// @brief Frees @p block preventing memory leaks
+/// @param block
+void mem_free(void *block) { mem_pool_free(&default_pool, block); }
+
+/// @brief Frees @p n blocks while taking the allocation lock once
+/// @param blocks blocks to free, sorted by address on return
+void mem_free_many(void **blocks, size_t n) {
+    mem_pool_free_many(&default_pool, blocks, n);
+}
+
+/// @brief Frees @p n blocks and allocates @p n blocks of @p size bytes packed
+/// into the lowest free memory, see mem_pool_repack
+/// @return number of new blocks
+size_t mem_repack(void **blocks, size_t n, size_t size) {
+    return mem_pool_repack(&default_pool, blocks, n, size);
+}
+
+/// @brief Changes the size of the allocated block, return NULL if failed
+/// @param block pointer to your allocated memory, if NULL allocates new memory
+/// of @p size
+/// @param size The new size of your allocated memory, if 0 mem_free is called
+/// for @p block
+/// @return
+void *mem_resize(void *block, size_t size) {
+    return mem_pool_resize(&default_pool, block, size);
+}
+
+/// @brief Size of the largest free gap, the largest block mem_alloc can
+/// currently return
+size_t mem_largest_free() { return mem_pool_largest_free(&default_pool); }
+
+/// @brief gives back the memory used by the memory manager
+void mem_deinit() { mem_pool_deinit(&default_pool); }
@@ -6,19 +6,63 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "locks.h"
+
+struct memory_block;
+struct free_range;
+
+/// Cache line size the hot shared state is laid out for
+#define MEM_CACHE_LINE 64
+
+/// @brief An independent memory manager instance, owns its memory region, its
+/// block list and its lock. The mem_* functions operate on a default pool.
+/// Fields that are only read after init sit on their own cache line, so the
+/// size checks done before taking the lock do not miss whenever another thread
+/// takes it.
+typedef struct mem_pool {
+    void *memory;
+    size_t size;
+    bool mapped;  // memory comes from mmap, see mem_pool_init_node
+    mem_lock allocation_lock __attribute__((aligned(MEM_CACHE_LINE)));
+    struct memory_block *head;
+    struct free_range *free_ranges;  // gaps between the blocks, by address
+} __attribute__((aligned(MEM_CACHE_LINE))) mem_pool;
+
 /// @brief Initiates the memory mannager with @p size bytes of memory
 /// @param size bytes that will be available in the memory manager
 void mem_init(size_t size);
 
+/// @brief Same as mem_init with a lock of @p kind guarding the allocations,
+/// for critical sections too short to be worth sleeping on
+void mem_init_lock(size_t size, mem_lock_kind kind);
+
 /// @brief Allocates @p size bytes of memory
 /// @param @p size number of bytes that will be allocated
 /// @return pointer to the allocated memory
 void* mem_alloc(size_t size);
 
+/// @brief Allocates up to @p n blocks of @p size bytes each while taking the
+/// allocation lock once
+/// @param blocks receives the allocated blocks, must have room for @p n
+/// @return number of blocks allocated, less than @p n if the memory ran out
+size_t mem_alloc_many(size_t size, size_t n, void** blocks);
+
 /// @brief Frees @p block preventing memory leaks
 /// @param block
 void mem_free(void* block);
 
+/// @brief Frees @p n blocks while taking the allocation lock once and walking
+/// the block list once. Sorts @p blocks by address.
+/// @param blocks blocks to free, pointers that are not allocated are ignored
+void mem_free_many(void** blocks, size_t n);
+
+/// @brief Frees @p n blocks and allocates @p n blocks of @p size bytes packed
+/// into the lowest free memory under one lock acquisition. Contents are not
+/// preserved.
+/// @param blocks blocks to free, receives the new blocks in address order
+/// @return number of new blocks
+size_t mem_repack(void** blocks, size_t n, size_t size);
+
 /// @brief Changes the size of the allocated block, return NULL if failed
 /// @param block pointer to your allocated memory, if NULL allocates new memory
 /// of @p size
@@ -27,8 +71,54 @@ void mem_free(void* block);
 /// @return
 void* mem_resize(void* block, size_t size);
 
+/// @brief Size of the largest free gap, the largest block mem_alloc can
+/// currently return
+size_t mem_largest_free();
+
 /// @brief gives back the memory used by the memory manager, makes the memory
 /// mannager unusable until new init
 void mem_deinit();
 
+/// @brief Initiates @p pool with @p size bytes of memory
+void mem_pool_init(mem_pool* pool, size_t size);
+
+/// @brief Same as mem_init_lock but on @p pool
+void mem_pool_init_lock(mem_pool* pool, size_t size, mem_lock_kind kind);
+
+/// @brief Allocates @p size bytes of memory from @p pool
+/// @return pointer to the allocated memory or NULL
+void* mem_pool_alloc(mem_pool* pool, size_t size);
+
+/// @brief Initiates @p pool with @p size bytes of memory placed on NUMA node
+/// @p node, for pools used by threads running on that node
+/// @return 0 if the memory is bound to @p node, -1 if it could not be (no
+/// such node, or no NUMA support), the pool is usable either way
+int mem_pool_init_node(mem_pool* pool, size_t size, int node);
+
+/// @brief Same as mem_alloc_many but on @p pool
+size_t mem_pool_alloc_many(mem_pool* pool, size_t size, size_t n,
+                           void** blocks);
+
+/// @brief Frees @p block that was allocated from @p pool
+void mem_pool_free(mem_pool* pool, void* block);
+
+/// @brief Same as mem_free_many but on @p pool
+void mem_pool_free_many(mem_pool* pool, void** blocks, size_t n);
+
+/// @brief Same as mem_repack but on @p pool
+size_t mem_pool_repack(mem_pool* pool, void** blocks, size_t n, size_t size);
+
+/// @brief Same as mem_resize but on @p pool
+void* mem_pool_resize(mem_pool* pool, void* block, size_t size);
+
+/// @brief Same as mem_largest_free but on @p pool
+size_t mem_pool_largest_free(mem_pool* pool);
+
+/// @brief Gives back the memory used by @p pool
+void mem_pool_deinit(mem_pool* pool);
+
+/// @brief The pool used by mem_init, mem_alloc, mem_free, mem_resize and
+/// mem_deinit
+mem_pool* mem_default_pool();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,413 @@
+// mm_preload.c
+// LD_PRELOAD=./libmmpreload.so <program> serves the program's small
+// allocations from a memory manager pool, to try the pool on unmodified
+// binaries. Requests up to the largest size class are rounded up to a class
+// and handed out from a per-thread cache, which is refilled from and
+// drained back to a shared free list per class in batches. Blocks are cut
+// from slabs the class takes from the pool, so the pool only ever sees
+// slabs, never single blocks, and its lock is taken once per slab. Slabs
+// are kept for the life of the process. Larger requests, alignments above
+// 16 bytes, and anything the pool cannot satisfy go to the system
+// allocator. free tells the two apart by address.
+//
+// MM_PRELOAD_POOL_SIZE sets the pool size in bytes (default 256 MiB).
+// MM_PRELOAD_CLASSES sets the size classes as an ascending, comma separated
+// list of up to 16 sizes (default 16,32,...,4096), for example the one the
+// interposer's CM2_STATS report suggests for a program.
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memory_manager.h"
+
+#define PRELOAD_POOL_SIZE ((size_t)256 << 20)
+#define PRELOAD_MIN_SMALL 16
+#define PRELOAD_DEFAULT_CLASSES 9    // 16, 32, ..., 4096 bytes
+#define PRELOAD_CLASSES 16           // at most
+#define PRELOAD_CLASS_LIMIT (64 * 1024)  // largest size class allowed
+#define PRELOAD_CACHE_BLOCKS 64  // per class and thread before draining
+#define PRELOAD_BATCH 32         // blocks moved per refill or drain
+#define PRELOAD_HEADER 16        // keeps blocks 16-byte aligned like malloc's
+#define PRELOAD_SLAB_SIZE (64 * 1024)  // at least, taken from the pool per class
+#define PRELOAD_SLAB_BLOCKS 8          // at least, per slab of large classes
+#define PRELOAD_MAGIC 0x4d4d5052u
+#define BOOTSTRAP_SIZE (64 * 1024)
+
+#define TLS __thread __attribute__((tls_model("initial-exec")))
+// Built with -fvisibility=hidden so the memory manager linked in does not
+// interpose the program's own mem_* symbols; only these are exported
+#define EXPORT __attribute__((visibility("default")))
+
+/// Precedes every block handed out from the pool, PRELOAD_HEADER bytes
+typedef struct {
+    uint32_t magic;  // PRELOAD_MAGIC, checked before size_class is trusted
+    uint32_t size_class;
+} __attribute__((aligned(PRELOAD_HEADER))) block_header;
+
+/// Blocks of one class shared by all threads: those drained from the thread
+/// caches, linked through their first word, then the uncut rest of the slab
+typedef struct {
+    mem_lock lock;
+    void *head;
+    char *slab_next;
+    char *slab_end;
+} __attribute__((aligned(MEM_CACHE_LINE))) central_list;
+
+/// Free blocks of one thread, linked through their first word
+typedef struct {
+    void *head[PRELOAD_CLASSES];
+    uint32_t count[PRELOAD_CLASSES];
+    int registered;  // the exit destructor will drain the cache
+} thread_cache;
+
+static void *(*sys_malloc)(size_t size);
+static void (*sys_free)(void *ptr);
+static void *(*sys_calloc)(size_t nmemb, size_t size);
+static void *(*sys_realloc)(void *ptr, size_t size);
+static void *(*sys_memalign)(size_t alignment, size_t size);
+static size_t (*sys_usable_size)(void *ptr);
+
+static mem_pool pool;
+static int pool_ready = 0;
+static pthread_key_t cache_key;
+static int init_state = 0;  // 0 not started, 1 running, 2 done
+static TLS int in_init = 0;
+static TLS int in_pool = 0;  // the pool's own allocations go to the system
+static TLS thread_cache cache;
+
+static size_t classes[PRELOAD_CLASSES];  // ascending multiples of 16
+static int class_count = 0;
+static central_list central[PRELOAD_CLASSES];
+
+static char bootstrap[BOOTSTRAP_SIZE] __attribute__((aligned(64)));
+static uintptr_t bootstrap_pos = 0;
+
+/// @brief Hands out never reused memory while dlsym looks up the system
+/// allocator, each block preceded by its size
+static void *bootstrap_alloc(size_t size) {
+    uintptr_t base = (uintptr_t)bootstrap;
+    uintptr_t pos = __atomic_load_n(&bootstrap_pos, __ATOMIC_RELAXED), start;
+    do {
+        start = (base + pos + 2 * PRELOAD_HEADER - 1) & ~(uintptr_t)(PRELOAD_HEADER - 1);
+        if (start + size < start || start + size > base + sizeof(bootstrap)) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&bootstrap_pos, &pos, start + size - base, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    ((size_t *)start)[-1] = size;
+    return (void *)start;
+}
+
+static bool is_bootstrap(void *ptr) {
+    return ptr >= (void *)bootstrap && ptr < (void *)(bootstrap + sizeof(bootstrap));
+}
+
+static bool pool_owns(void *ptr) {
+    return pool_ready && ptr >= pool.memory && (char *)ptr < (char *)pool.memory + pool.size;
+}
+
+static size_t class_size(int size_class) {
+    return classes[size_class];
+}
+
+static size_t max_small(void) {
+    return class_count ? classes[class_count - 1] : 0;
+}
+
+/// @return the smallest class holding @p size bytes, -1 if none does
+static int class_of(size_t size) {
+    if (size > max_small()) return -1;
+    int size_class = 0;
+    while (class_size(size_class) < size) size_class++;
+    return size_class;
+}
+
+/// @brief Sets the size classes from an MM_PRELOAD_CLASSES list, each size
+/// rounded up to a multiple of 16, or to the default if @p list is missing
+/// or not strictly ascending
+static void set_classes(const char *list) {
+    class_count = 0;
+    while (list && *list && class_count < PRELOAD_CLASSES) {
+        char *end;
+        size_t size = strtoull(list, &end, 10);
+        size = (size + PRELOAD_MIN_SMALL - 1) & ~(size_t)(PRELOAD_MIN_SMALL - 1);
+        if (end == list || size == 0 || size > PRELOAD_CLASS_LIMIT ||
+            (class_count && size <= classes[class_count - 1]) || (*end && *end != ',')) {
+            static const char message[] = "mm_preload: bad MM_PRELOAD_CLASSES, using the default\n";
+            if (write(2, message, sizeof(message) - 1) < 0) {
+            }
+            class_count = 0;
+            break;
+        }
+        classes[class_count++] = size;
+        list = *end ? end + 1 : end;
+    }
+    if (class_count) return;
+    for (int size_class = 0; size_class < PRELOAD_DEFAULT_CLASSES; size_class++)
+        classes[class_count++] = (size_t)PRELOAD_MIN_SMALL << size_class;
+}
+
+static block_header *header_of(void *ptr) {
+    return (block_header *)((char *)ptr - PRELOAD_HEADER);
+}
+
+/// @return the size class of the pool block @p ptr, aborts if @p ptr is not
+/// the start of one
+static int class_of_block(void *ptr) {
+    block_header *header = header_of(ptr);
+    if (header->magic != PRELOAD_MAGIC || header->size_class >= (uint32_t)class_count) {
+        static const char message[] = "mm_preload: pointer not from malloc\n";
+        if (write(2, message, sizeof(message) - 1) < 0) {
+        }
+        abort();
+    }
+    return header->size_class;
+}
+
+/// @brief Makes sure the exit destructor drains the calling thread's cache,
+/// again if a block is freed after it already ran
+static void register_cache(void) {
+    if (cache.registered) return;
+    cache.registered = 1;
+    pthread_setspecific(cache_key, &cache);
+}
+
+/// @brief Gives up to @p n cached blocks of @p size_class back to the shared
+/// list of the class
+static void drain(int size_class, uint32_t n) {
+    void *first = cache.head[size_class], *last = NULL;
+    uint32_t taken = 0;
+    for (void *ptr = first; ptr && taken < n; ptr = *(void **)ptr, taken++) last = ptr;
+    if (!taken) return;
+    cache.head[size_class] = *(void **)last;
+    cache.count[size_class] -= taken;
+
+    central_list *list = &central[size_class];
+    mem_lock_acquire(&list->lock);
+    *(void **)last = list->head;
+    list->head = first;
+    mem_lock_release(&list->lock);
+}
+
+/// @brief Drains the cache of an exiting thread
+static void drain_all(void *unused) {
+    (void)unused;
+    cache.registered = 0;
+    for (int size_class = 0; size_class < class_count; size_class++)
+        drain(size_class, cache.count[size_class]);
+}
+
+/// @brief Bytes of the slabs of @p size_class
+static size_t slab_size(int size_class) {
+    size_t blocks = (PRELOAD_HEADER + class_size(size_class)) * PRELOAD_SLAB_BLOCKS;
+    return blocks > PRELOAD_SLAB_SIZE ? blocks : PRELOAD_SLAB_SIZE;
+}
+
+/// @brief Fills the cache of @p size_class with a batch from the shared list,
+/// cutting new blocks from the slab, and taking a new slab from the pool,
+/// when that runs out
+static void refill(int size_class) {
+    register_cache();
+    central_list *list = &central[size_class];
+    size_t stride = PRELOAD_HEADER + class_size(size_class);
+    uint32_t n = 0;
+    mem_lock_acquire(&list->lock);
+    while (n < PRELOAD_BATCH && list->head) {
+        void *ptr = list->head;
+        list->head = *(void **)ptr;
+        *(void **)ptr = cache.head[size_class];
+        cache.head[size_class] = ptr;
+        n++;
+    }
+    while (n < PRELOAD_BATCH) {
+        if ((size_t)(list->slab_end - list->slab_next) < stride) {
+            in_pool = 1;
+            char *slab = mem_pool_alloc(&pool, slab_size(size_class));
+            in_pool = 0;
+            if (!slab) break;  // pool exhausted
+            list->slab_next = slab;
+            list->slab_end = slab + slab_size(size_class);
+        }
+        block_header *header = (block_header *)list->slab_next;
+        list->slab_next += stride;
+        header->magic = PRELOAD_MAGIC;
+        header->size_class = size_class;
+        void *ptr = (char *)header + PRELOAD_HEADER;
+        *(void **)ptr = cache.head[size_class];
+        cache.head[size_class] = ptr;
+        n++;
+    }
+    mem_lock_release(&list->lock);
+    cache.count[size_class] += n;
+}
+
+/// @brief Holds every lock of the shim and the pool across fork, so the
+/// child does not inherit one that a thread gone in it was holding
+static void fork_prepare(void) {
+    for (int size_class = 0; size_class < class_count; size_class++)
+        mem_lock_acquire(&central[size_class].lock);
+    mem_lock_acquire(&pool.allocation_lock);
+}
+
+static void fork_release(void) {
+    mem_lock_release(&pool.allocation_lock);
+    for (int size_class = class_count - 1; size_class >= 0; size_class--)
+        mem_lock_release(&central[size_class].lock);
+}
+
+static void init(void) {
+    sys_malloc = dlsym(RTLD_NEXT, "malloc");
+    sys_free = dlsym(RTLD_NEXT, "free");
+    sys_calloc = dlsym(RTLD_NEXT, "calloc");
+    sys_realloc = dlsym(RTLD_NEXT, "realloc");
+    sys_memalign = dlsym(RTLD_NEXT, "memalign");
+    sys_usable_size = dlsym(RTLD_NEXT, "malloc_usable_size");
+    if (!sys_malloc || !sys_free || !sys_calloc || !sys_realloc || !sys_memalign ||
+        !sys_usable_size) {
+        static const char message[] = "mm_preload: system allocator not found\n";
+        if (write(2, message, sizeof(message) - 1) < 0) {
+        }
+        _exit(1);
+    }
+
+    set_classes(getenv("MM_PRELOAD_CLASSES"));
+    const char *size = getenv("MM_PRELOAD_POOL_SIZE");
+    pthread_key_create(&cache_key, drain_all);
+    in_pool = 1;
+    mem_pool_init_lock(&pool, size ? strtoull(size, NULL, 10) : PRELOAD_POOL_SIZE,
+                       MEM_LOCK_ADAPTIVE);
+    in_pool = 0;
+    pool_ready = pool.memory != NULL;
+    if (!pool_ready) return;
+    for (int size_class = 0; size_class < class_count; size_class++)
+        mem_lock_init(&central[size_class].lock, MEM_LOCK_ADAPTIVE);
+    pthread_atfork(fork_prepare, fork_release, fork_release);
+}
+
+/// @brief Looks the system allocator up and sets the pool up, once
+/// @return false while that is still going on (in this thread or another),
+/// the caller then takes bootstrap memory
+static bool ensure_init(void) {
+    if (__atomic_load_n(&init_state, __ATOMIC_ACQUIRE) == 2) return true;
+    int expected = 0;
+    if (in_init || !__atomic_compare_exchange_n(&init_state, &expected, 1, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return false;
+    in_init = 1;
+    init();
+    in_init = 0;
+    __atomic_store_n(&init_state, 2, __ATOMIC_RELEASE);
+    return true;
+}
+
+EXPORT void *malloc(size_t size) {
+    if (in_pool) return sys_malloc(size);
+    if (!ensure_init()) return bootstrap_alloc(size);
+    int size_class = class_of(size ? size : 1);
+    if (size_class < 0 || !pool_ready) return sys_malloc(size);
+    if (!cache.head[size_class]) refill(size_class);
+    void *ptr = cache.head[size_class];
+    if (!ptr) return sys_malloc(size);  // pool exhausted
+    cache.head[size_class] = *(void **)ptr;
+    cache.count[size_class]--;
+    return ptr;
+}
+
+EXPORT void free(void *ptr) {
+    if (!ptr || is_bootstrap(ptr)) return;
+    if (in_pool || !pool_owns(ptr)) {
+        // nothing but bootstrap blocks exist before init
+        if (sys_free) sys_free(ptr);
+        return;
+    }
+    register_cache();
+    int size_class = class_of_block(ptr);
+    *(void **)ptr = cache.head[size_class];
+    cache.head[size_class] = ptr;
+    if (++cache.count[size_class] > PRELOAD_CACHE_BLOCKS) drain(size_class, PRELOAD_BATCH);
+}
+
+EXPORT void *calloc(size_t nmemb, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(nmemb, size, &bytes)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (in_pool) return sys_calloc(nmemb, size);
+    if (!ensure_init()) {
+        void *ptr = bootstrap_alloc(bytes);
+        if (ptr) memset(ptr, 0, bytes);
+        return ptr;
+    }
+    // Large blocks come zeroed from fresh pages, leave them to the system
+    if (bytes > max_small()) return sys_calloc(nmemb, size);
+    void *ptr = malloc(bytes);
+    if (ptr) memset(ptr, 0, bytes);
+    return ptr;
+}
+
+EXPORT void *realloc(void *ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    if (in_pool) return sys_realloc(ptr, size);
+    size_t old_size;
+    if (is_bootstrap(ptr))
+        old_size = ((size_t *)ptr)[-1];
+    else if (pool_owns(ptr))
+        old_size = class_size(class_of_block(ptr));
+    else
+        return sys_realloc(ptr, size);
+
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    // Stay in the block while it fits and is not mostly wasted
+    if (!is_bootstrap(ptr) && size <= old_size && size > old_size / 4) return ptr;
+    void *moved = malloc(size);
+    if (!moved) return NULL;
+    memcpy(moved, ptr, old_size < size ? old_size : size);
+    free(ptr);
+    return moved;
+}
+
+EXPORT void *memalign(size_t alignment, size_t size) {
+    if (alignment <= PRELOAD_HEADER) return malloc(size);
+    if (in_pool || ensure_init()) return sys_memalign(alignment, size);
+    // before init: over-allocate and align inside the bootstrap arena, with
+    // the size just before the aligned block like bootstrap_alloc's
+    char *ptr = bootstrap_alloc(size + alignment + sizeof(size_t));
+    if (!ptr) return NULL;
+    uintptr_t aligned =
+        ((uintptr_t)ptr + sizeof(size_t) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    ((size_t *)aligned)[-1] = size;
+    return (void *)aligned;
+}
+
+EXPORT int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1))) return EINVAL;
+    void *ptr = memalign(alignment, size);
+    if (!ptr && size) return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+EXPORT void *aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return memalign(alignment, size);
+}
+
+EXPORT size_t malloc_usable_size(void *ptr) {
+    if (!ptr) return 0;
+    if (is_bootstrap(ptr)) return ((size_t *)ptr)[-1];
+    if (pool_owns(ptr)) return class_size(class_of_block(ptr));
+    return sys_usable_size ? sys_usable_size(ptr) : 0;
+}
@@ -0,0 +1,95 @@
+#define _GNU_SOURCE
+#include "rcu.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Per-thread reader indicator, padded to a cache line so that readers never
+/// write to a line another thread writes to
+typedef struct {
+    uint64_t epoch;  // epoch the current read section started in, 0 if none
+    int in_use;      // slot is owned by a live thread
+} __attribute__((aligned(64))) rcu_reader;
+
+static rcu_reader readers[RCU_MAX_READERS];
+static uint64_t global_epoch = 1;
+static size_t readers_high = 0;  // one past the highest slot ever claimed
+
+static __thread rcu_reader *self = NULL;
+static __thread unsigned nesting = 0;
+
+static pthread_key_t reader_key;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+
+/// @brief Gives the slot of an exiting thread back to the pool
+static void release_slot(void *slot) {
+    __atomic_store_n(&((rcu_reader *)slot)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void make_reader_key(void) {
+    pthread_key_create(&reader_key, release_slot);
+}
+
+/// @brief Claims a free reader slot for the calling thread, waits for one to be
+/// released if all are taken
+/// @return the claimed slot
+static rcu_reader *claim_slot(void) {
+    pthread_once(&reader_key_once, make_reader_key);
+    for (;;) {
+        for (size_t i = 0; i < RCU_MAX_READERS; i++) {
+            if (__atomic_load_n(&readers[i].in_use, __ATOMIC_RELAXED)) continue;
+            int expected = 0;
+            if (!__atomic_compare_exchange_n(&readers[i].in_use, &expected, 1,
+                                             false, __ATOMIC_SEQ_CST,
+                                             __ATOMIC_RELAXED))
+                continue;
+            size_t high = __atomic_load_n(&readers_high, __ATOMIC_RELAXED);
+            while (high < i + 1 &&
+                   !__atomic_compare_exchange_n(&readers_high, &high, i + 1,
+                                                false, __ATOMIC_SEQ_CST,
+                                                __ATOMIC_RELAXED)) {
+            }
+            pthread_setspecific(reader_key, &readers[i]);
+            return &readers[i];
+        }
+        sched_yield();
+    }
+}
+
+/// @brief Enters a read-side critical section. Only writes to the calling
+/// thread's own reader slot, never to shared state. Sections may nest.
+void rcu_read_lock(void) {
+    if (nesting++ > 0) return;
+    if (!self) self = claim_slot();
+    __atomic_store_n(&self->epoch,
+                     __atomic_load_n(&global_epoch, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    // Pairs with the fence in rcu_synchronize: either the writer sees our
+    // epoch or we see everything it unlinked before starting the grace period
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/// @brief Leaves a read-side critical section
+void rcu_read_unlock(void) {
+    if (--nesting > 0) return;
+    __atomic_store_n(&self->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/// @brief Waits until every read-side critical section that was active when
+/// the call started has finished (a grace period). Memory that was unlinked
+/// before the call can be reclaimed once it returns.
+void rcu_synchronize(void) {
+    uint64_t target = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    size_t high = __atomic_load_n(&readers_high, __ATOMIC_SEQ_CST);
+    for (size_t i = 0; i < high; i++) {
+        uint64_t epoch;
+        while ((epoch = __atomic_load_n(&readers[i].epoch, __ATOMIC_ACQUIRE)) !=
+                   0 &&
+               epoch < target) {
+            sched_yield();
+        }
+    }
+}
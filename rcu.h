@@ -0,0 +1,23 @@
+// rcu.h
+#ifndef RCU_H
+#define RCU_H
+
+#include <stdint.h>
+
+/// Maximum number of threads that can be inside a read-side critical section
+/// at the same time. A thread keeps its slot until it exits.
+#define RCU_MAX_READERS 1024
+
+/// @brief Enters a read-side critical section. Only writes to the calling
+/// thread's own reader slot, never to shared state. Sections may nest.
+void rcu_read_lock(void);
+
+/// @brief Leaves a read-side critical section
+void rcu_read_unlock(void);
+
+/// @brief Waits until every read-side critical section that was active when
+/// the call started has finished (a grace period). Memory that was unlinked
+/// before the call can be reclaimed once it returns.
+void rcu_synchronize(void);
+
+#endif  // RCU_H
@@ -0,0 +1,484 @@
+// replay_trace.c
+// Replays a binary allocation trace recorded by the cM2.c interposer
+// (CM2_TRACE=<file>) through mem_alloc/mem_free/mem_resize, or through
+// malloc/free/realloc for comparison, and reports throughput and latency
+// percentiles per call as CSV (default) or JSON lines.
+//
+// Every block of the trace gets a slot. A pass over the trace in time order
+// turns addresses into slots, so the replay does not depend on where either
+// allocator places blocks. With -t N the recorded threads are spread over N
+// replay threads; a thread that frees a block another one allocated waits
+// until that allocation has been replayed.
+//
+// usage: replay_trace [-f csv|json] [-t threads] [-b pool|malloc]
+//                     [-l mutex|ticket|adaptive] [-s pool bytes] trace
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "alloc_trace.h"
+#include "bench_common.h"
+#include "memory_manager.h"
+
+#define NO_SLOT UINT32_MAX
+#define FAILED ((void *)1)  // allocation of the slot failed during replay
+#define FREED ((void *)2)   // slot was released during replay
+
+enum { OP_ALLOC, OP_FREE, OP_RESIZE, OP_KINDS };
+static const char *op_names[OP_KINDS] = {"alloc", "free", "resize"};
+
+/// Allocator the trace is replayed through
+typedef struct {
+    bool pool;  // the memory manager rather than malloc
+    void *(*alloc)(size_t size);
+    void (*free)(void *block);
+    void *(*resize)(void *block, size_t size);
+} backend;
+
+static const backend pool_backend = {true, mem_alloc, mem_free, mem_resize};
+static const backend malloc_backend = {false, malloc, free, realloc};
+
+/// A trace record with its addresses resolved to slots
+typedef struct {
+    uint64_t size;
+    uint32_t old_slot;  // block released, NO_SLOT if none
+    uint32_t new_slot;  // block produced, NO_SLOT if none
+    uint32_t thread;
+    uint8_t kind;       // OP_*
+    bool zero;          // calloc, clear the block
+} replay_op;
+
+/// Release or acquisition of an address, see alloc_trace_record
+typedef struct {
+    uint64_t time_ns;
+    uint32_t record;
+    uint8_t acquire;  // releases sort first on equal times
+} address_event;
+
+/// Open addressing map from live addresses to slots
+typedef struct {
+    uint64_t *keys;  // 0 marks an empty entry
+    uint32_t *slots;
+    size_t mask;
+} address_map;
+
+static size_t hash_address(uint64_t address) {
+    return (address >> 4) * 0x9e3779b97f4a7c15ULL >> 17;
+}
+
+static void map_put(address_map *map, uint64_t address, uint32_t slot) {
+    size_t i = hash_address(address) & map->mask;
+    while (map->keys[i] && map->keys[i] != address) i = (i + 1) & map->mask;
+    map->keys[i] = address;
+    map->slots[i] = slot;
+}
+
+/// @brief Removes @p address from @p map
+/// @return its slot, NO_SLOT if it was not in the map
+static uint32_t map_take(address_map *map, uint64_t address) {
+    size_t i = hash_address(address) & map->mask;
+    while (map->keys[i] != address) {
+        if (!map->keys[i]) return NO_SLOT;
+        i = (i + 1) & map->mask;
+    }
+    uint32_t slot = map->slots[i];
+    // Backward shift deletion keeps probe chains unbroken without tombstones
+    size_t hole = i;
+    for (size_t j = (i + 1) & map->mask; map->keys[j]; j = (j + 1) & map->mask) {
+        size_t home = hash_address(map->keys[j]) & map->mask;
+        if (((j - home) & map->mask) >= ((j - hole) & map->mask)) {
+            map->keys[hole] = map->keys[j];
+            map->slots[hole] = map->slots[j];
+            hole = j;
+        }
+    }
+    map->keys[hole] = 0;
+    return slot;
+}
+
+static int compare_events(const void *a, const void *b) {
+    const address_event *x = a, *y = b;
+    if (x->time_ns != y->time_ns) return x->time_ns < y->time_ns ? -1 : 1;
+    if (x->acquire != y->acquire) return x->acquire - y->acquire;
+    return (x->record > y->record) - (x->record < y->record);
+}
+
+static const alloc_trace_record *sort_records;
+
+static int compare_records(const void *a, const void *b) {
+    const alloc_trace_record *x = &sort_records[*(const uint32_t *)a];
+    const alloc_trace_record *y = &sort_records[*(const uint32_t *)b];
+    if (x->start_ns != y->start_ns) return x->start_ns < y->start_ns ? -1 : 1;
+    uint64_t x_end = x->start_ns + x->duration_ns;
+    uint64_t y_end = y->start_ns + y->duration_ns;
+    if (x_end != y_end) return x_end < y_end ? -1 : 1;
+    return (*(const uint32_t *)a > *(const uint32_t *)b) -
+           (*(const uint32_t *)a < *(const uint32_t *)b);
+}
+
+/// @brief Reads @p path
+/// @return the records, NULL with a message on stderr if the file is not a
+/// trace
+static alloc_trace_record *load_trace(const char *path, size_t *count) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+    alloc_trace_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != ALLOC_TRACE_MAGIC ||
+        header.version != ALLOC_TRACE_VERSION ||
+        header.record_size != sizeof(alloc_trace_record)) {
+        fprintf(stderr, "%s: not an allocation trace of this version\n", path);
+        fclose(file);
+        return NULL;
+    }
+    size_t capacity = 1024, n = 0;
+    alloc_trace_record *records = malloc(capacity * sizeof(*records));
+    while (records) {
+        n += fread(records + n, sizeof(*records), capacity - n, file);
+        if (n < capacity) break;
+        capacity *= 2;
+        alloc_trace_record *grown = realloc(records, capacity * sizeof(*records));
+        if (!grown) free(records);
+        records = grown;
+    }
+    fclose(file);
+    *count = n;
+    return records;
+}
+
+/// @brief Resolves the addresses of @p records to slots
+/// @param ops filled with one replay_op per record
+/// @param peak_bytes set to the largest number of bytes live at once
+/// @return number of slots
+static uint32_t resolve(const alloc_trace_record *records, size_t n,
+                        replay_op *ops, size_t *peak_bytes) {
+    address_event *events = malloc(2 * n * sizeof(address_event));
+    size_t event_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        const alloc_trace_record *r = &records[i];
+        ops[i] = (replay_op){.size = r->size,
+                             .old_slot = NO_SLOT,
+                             .new_slot = NO_SLOT,
+                             .thread = r->thread,
+                             .kind = OP_ALLOC,
+                             .zero = r->op == ALLOC_TRACE_CALLOC};
+        uint64_t released = 0, acquired = r->id;
+        if (r->op == ALLOC_TRACE_FREE) {
+            ops[i].kind = OP_FREE;
+            released = r->id;
+            acquired = 0;
+        } else if (r->op == ALLOC_TRACE_REALLOC) {
+            ops[i].kind = OP_RESIZE;
+            // A failed realloc keeps the old block, realloc(p, 0) frees it
+            if (r->id || r->size == 0) released = r->old_id;
+        }
+        if (released)
+            events[event_count++] =
+                (address_event){r->start_ns, (uint32_t)i, 0};
+        if (acquired)
+            events[event_count++] = (address_event){
+                r->start_ns + r->duration_ns, (uint32_t)i, 1};
+    }
+    qsort(events, event_count, sizeof(address_event), compare_events);
+
+    address_map map;
+    size_t capacity = 16;
+    while (capacity < 2 * n) capacity *= 2;
+    map.keys = calloc(capacity, sizeof(uint64_t));
+    map.slots = malloc(capacity * sizeof(uint32_t));
+    map.mask = capacity - 1;
+    uint64_t *slot_sizes = malloc((n + 1) * sizeof(uint64_t));
+    uint32_t slots = 0;
+    size_t live = 0;
+    *peak_bytes = 0;
+    for (size_t e = 0; e < event_count; e++) {
+        const alloc_trace_record *r = &records[events[e].record];
+        replay_op *op = &ops[events[e].record];
+        if (events[e].acquire) {
+            op->new_slot = slots;
+            slot_sizes[slots++] = r->size;
+            map_put(&map, r->id, op->new_slot);
+            live += r->size;
+            if (live > *peak_bytes) *peak_bytes = live;
+        } else {
+            op->old_slot = map_take(
+                &map, r->op == ALLOC_TRACE_FREE ? r->id : r->old_id);
+            if (op->old_slot != NO_SLOT) live -= slot_sizes[op->old_slot];
+        }
+    }
+    free(slot_sizes);
+    free(map.keys);
+    free(map.slots);
+    free(events);
+    return slots;
+}
+
+typedef struct {
+    const backend *backend;
+    const replay_op *ops;
+    const uint32_t *order;  // indexes into ops, in replay order
+    size_t count;
+    void **slots;
+    bool shared;  // other threads replay too, wait for their blocks
+    pthread_barrier_t *start;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    bench_samples samples[OP_KINDS];
+    size_t failures;
+} replay_thread;
+
+/// @brief Block of @p slot, waiting for another thread to produce it
+static void *slot_block(replay_thread *self, uint32_t slot) {
+    if (slot == NO_SLOT) return FAILED;
+    void *block;
+    while (!(block = __atomic_load_n(&self->slots[slot], __ATOMIC_ACQUIRE))) {
+        if (!self->shared) return FAILED;
+        sched_yield();
+    }
+    return block;
+}
+
+static void publish(replay_thread *self, uint32_t slot, void *block) {
+    if (slot != NO_SLOT)
+        __atomic_store_n(&self->slots[slot], block ? block : FAILED,
+                         __ATOMIC_RELEASE);
+}
+
+static void replay(replay_thread *self, const replay_op *op) {
+    const backend *with = self->backend;
+    // malloc(0) returns a block, the pool hands out no block for 0 bytes
+    size_t size = op->size ? op->size : 1;
+    void *old = op->old_slot == NO_SLOT ? FAILED : slot_block(self, op->old_slot);
+    bool has_old = old != FAILED && old != FREED;
+    void *block = NULL;
+    uint64_t begin = bench_now_ns();
+    switch (op->kind) {
+        case OP_FREE:
+            if (!has_old) return;
+            with->free(old);
+            break;
+        case OP_RESIZE:
+            if (op->new_slot == NO_SLOT) {
+                if (!has_old) return;
+                with->free(old);
+            } else if (has_old) {
+                block = with->resize(old, size);
+                // The old block stays live if it could not be resized
+                if (!block) {
+                    self->failures++;
+                    block = old;
+                }
+            } else {
+                block = with->alloc(size);
+            }
+            break;
+        default:
+            if (op->new_slot == NO_SLOT) return;
+            block = with->alloc(size);
+            if (block && op->zero) memset(block, 0, op->size);
+            break;
+    }
+    bench_record(&self->samples[op->kind], bench_now_ns() - begin);
+    if (op->new_slot != NO_SLOT && !block) self->failures++;
+    // The old slot hands its block on, or gives it back
+    if (has_old) __atomic_store_n(&self->slots[op->old_slot], FREED, __ATOMIC_RELEASE);
+    publish(self, op->new_slot, block);
+}
+
+static void *replay_worker(void *arg) {
+    replay_thread *self = arg;
+    pthread_barrier_wait(self->start);
+    self->begin_ns = bench_now_ns();
+    for (size_t i = 0; i < self->count; i++)
+        replay(self, &self->ops[self->order[i]]);
+    self->end_ns = bench_now_ns();
+    return NULL;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-f csv|json] [-t threads] [-b pool|malloc] "
+            "[-l mutex|ticket|adaptive] [-s pool bytes] trace\n"
+            "  -f  output format (default csv)\n"
+            "  -t  replay threads, recorded threads are spread over them "
+            "(default 1)\n"
+            "  -b  allocator to replay through (default pool)\n"
+            "  -l  allocation lock of the pool (default mutex)\n"
+            "  -s  pool size, default twice the peak live bytes plus headers\n",
+            name);
+}
+
+int main(int argc, char *argv[]) {
+    bench_format format = BENCH_CSV;
+    int threads = 1;
+    const backend *with = &pool_backend;
+    mem_lock_kind lock = MEM_LOCK_MUTEX;
+    size_t pool_size = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:t:b:l:s:")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (bench_parse_format(optarg, &format) != 0) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'b':
+                if (strcmp(optarg, "malloc") == 0)
+                    with = &malloc_backend;
+                else if (strcmp(optarg, "pool") == 0)
+                    with = &pool_backend;
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'l':
+                if (strcmp(optarg, "ticket") == 0)
+                    lock = MEM_LOCK_TICKET;
+                else if (strcmp(optarg, "adaptive") == 0)
+                    lock = MEM_LOCK_ADAPTIVE;
+                else if (strcmp(optarg, "mutex") == 0)
+                    lock = MEM_LOCK_MUTEX;
+                else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 's':
+                pool_size = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc - 1 || threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *path = argv[optind];
+    size_t n;
+    alloc_trace_record *records = load_trace(path, &n);
+    if (!records) return 1;
+    replay_op *ops = malloc((n ? n : 1) * sizeof(replay_op));
+    size_t peak_bytes;
+    uint32_t slot_count = resolve(records, n, ops, &peak_bytes);
+
+    // Replay order is call order, which also puts every release after the
+    // acquisition of its block
+    uint32_t *order = malloc((n ? n : 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++) order[i] = (uint32_t)i;
+    sort_records = records;
+    qsort(order, n, sizeof(uint32_t), compare_records);
+    free(records);
+
+    // Recorded thread t replays on thread (t - 1) % threads
+    replay_thread *workers = calloc(threads, sizeof(replay_thread));
+    uint32_t *split = malloc((n ? n : 1) * sizeof(uint32_t));
+    size_t *offsets = calloc(threads + 1, sizeof(size_t));
+    for (size_t i = 0; i < n; i++)
+        offsets[(ops[i].thread ? ops[i].thread - 1 : 0) % threads + 1]++;
+    for (int t = 0; t < threads; t++) offsets[t + 1] += offsets[t];
+    size_t *fill = calloc(threads, sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        int t = (ops[order[i]].thread ? ops[order[i]].thread - 1 : 0) % threads;
+        split[offsets[t] + fill[t]++] = order[i];
+    }
+    free(fill);
+    free(order);
+
+    fprintf(stderr, "%s: %zu calls, %u blocks, %zu bytes live at most\n", path,
+            n, slot_count, peak_bytes);
+    if (with->pool) {
+        if (!pool_size) pool_size = 2 * peak_bytes + (size_t)slot_count * 64 + 4096;
+        mem_init_lock(pool_size, lock);
+    }
+
+    void **slots = calloc(slot_count ? slot_count : 1, sizeof(void *));
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, threads + 1);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (replay_thread){.backend = with,
+                                     .ops = ops,
+                                     .order = split + offsets[t],
+                                     .count = offsets[t + 1] - offsets[t],
+                                     .slots = slots,
+                                     .shared = threads > 1,
+                                     .start = &start};
+        for (int op = 0; op < OP_KINDS; op++)
+            bench_samples_init(&workers[t].samples[op], workers[t].count);
+        pthread_create(&ids[t], NULL, replay_worker, &workers[t]);
+    }
+    pthread_barrier_wait(&start);
+    for (int t = 0; t < threads; t++) pthread_join(ids[t], NULL);
+    uint64_t begin = workers[0].begin_ns, end = workers[0].end_ns;
+    for (int t = 1; t < threads; t++) {
+        if (workers[t].begin_ns < begin) begin = workers[t].begin_ns;
+        if (workers[t].end_ns > end) end = workers[t].end_ns;
+    }
+
+    bench_samples all, per_op[OP_KINDS];
+    bench_samples_init(&all, 0);
+    size_t failures = 0;
+    for (int op = 0; op < OP_KINDS; op++) {
+        bench_samples_init(&per_op[op], 0);
+        for (int t = 0; t < threads; t++) {
+            bench_samples_merge(&per_op[op], &workers[t].samples[op]);
+            bench_samples_merge(&all, &workers[t].samples[op]);
+        }
+    }
+    for (int t = 0; t < threads; t++) failures += workers[t].failures;
+
+    const char *base = strrchr(path, '/');
+    char workload[256];
+    snprintf(workload, sizeof(workload), "%s/%s", base ? base + 1 : path,
+             with->pool ? mem_lock_name(lock) : "malloc");
+    bench_row row = {.bench = "replay",
+                     .workload = workload,
+                     .op = "all",
+                     .threads = threads,
+                     .ops = all.count,
+                     .seconds = (end - begin) / 1e9,
+                     .failures = failures};
+    bench_print_header(stdout, format);
+    bench_row_latencies(&row, &all);
+    bench_print_row(stdout, format, &row);
+    for (int op = 0; op < OP_KINDS; op++) {
+        row.op = op_names[op];
+        row.ops = per_op[op].count;
+        row.failures = 0;
+        bench_row_latencies(&row, &per_op[op]);
+        bench_print_row(stdout, format, &row);
+        bench_samples_free(&per_op[op]);
+    }
+    bench_samples_free(&all);
+
+    for (uint32_t s = 0; s < slot_count; s++)
+        if (slots[s] && slots[s] != FAILED && slots[s] != FREED)
+            with->free(slots[s]);
+    if (with->pool) mem_deinit();
+    for (int t = 0; t < threads; t++)
+        for (int op = 0; op < OP_KINDS; op++)
+            bench_samples_free(&workers[t].samples[op]);
+    pthread_barrier_destroy(&start);
+    free(ids);
+    free(slots);
+    free(offsets);
+    free(split);
+    free(workers);
+    free(ops);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#define _GNU_SOURCE
+#include "sharded_list.h"
+
+/// One List per cache line boundary so that the locks and counters of
+/// neighbouring shards never share a line
+typedef struct list_shard {
+    List list;
+} __attribute__((aligned(MEM_CACHE_LINE))) list_shard;
+
+/// @brief Maps @p data to its shard, multiplicative hashing keeps runs of
+/// consecutive values spread over all shards
+static inline List *shard_of(ShardedList *list, uint16_t data) {
+    uint32_t hash = ((uint32_t)data * 2654435761u) >> 16;
+    return &list->shards[hash % list->num_shards].list;
+}
+
+/// @brief Initializes @p list with @p num_shards shards
+/// @param list list to initialize
+/// @param num_shards number of independent sub-lists
+/// @param shard_size bytes available for nodes in each shard
+/// @param mode reader/writer synchronization of every shard
+void sharded_list_init(ShardedList *list, size_t num_shards, size_t shard_size,
+                       list_sync_mode mode) {
+    if (num_shards == 0) num_shards = 1;
+    list->num_shards = num_shards;
+    list->shards = aligned_alloc(MEM_CACHE_LINE, num_shards * sizeof(list_shard));
+    if (!list->shards) {
+        perror("aligned_alloc failed");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < num_shards; i++)
+        list_h_init(&list->shards[i].list, shard_size, mode);
+}
+
+/// @brief Inserts @p data last in its shard
+void sharded_list_insert(ShardedList *list, uint16_t data) {
+    list_h_insert(shard_of(list, data), data);
+}
+
+/// @brief Deletes one node with @p data
+void sharded_list_delete(ShardedList *list, uint16_t data) {
+    list_h_delete(shard_of(list, data), data);
+}
+
+/// @brief return the pointer to a node with data or NULL if not found, only
+/// the shard @p data hashes to is searched
+Node *sharded_list_search(ShardedList *list, uint16_t data) {
+    return list_h_search(shard_of(list, data), data);
+}
+
+/// @brief Sums the per-shard counts without taking any lock. With concurrent
+/// writers the result is not a snapshot of one instant, but every completed
+/// insert and delete is reflected.
+/// @return size_t
+size_t sharded_list_count_nodes(ShardedList *list) {
+    size_t count = 0;
+    for (size_t i = 0; i < list->num_shards; i++)
+        count += list_h_count_nodes(&list->shards[i].list);
+    return count;
+}
+
+/// @brief frees all shards
+void sharded_list_cleanup(ShardedList *list) {
+    for (size_t i = 0; i < list->num_shards; i++)
+        list_h_cleanup(&list->shards[i].list);
+    free(list->shards);
+    list->shards = NULL;
+    list->num_shards = 0;
+}
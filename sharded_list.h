@@ -0,0 +1,24 @@
+// sharded_list.h
+#ifndef SHARDED_LIST_H
+#define SHARDED_LIST_H
+
+#include "linked_list.h"
+
+struct list_shard;
+
+/// @brief Values are hashed to one of num_shards independent Lists, each with
+/// its own lock and pool, so operations on different shards never contend
+typedef struct ShardedList {
+    size_t num_shards;
+    struct list_shard *shards;
+} ShardedList;
+
+void sharded_list_init(ShardedList *list, size_t num_shards, size_t shard_size,
+                       list_sync_mode mode);
+void sharded_list_insert(ShardedList *list, uint16_t data);
+void sharded_list_delete(ShardedList *list, uint16_t data);
+Node *sharded_list_search(ShardedList *list, uint16_t data);
+size_t sharded_list_count_nodes(ShardedList *list);
+void sharded_list_cleanup(ShardedList *list);
+
+#endif  // SHARDED_LIST_H
@@ -1,10 +1,15 @@
 #include "linked_list.h"
+#include "sharded_list.h"
+#include "worker_pool.h"
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
 #include <stddef.h>
 #include <math.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include "common_defs.h"
 #include "gitdata.h"
 
@@ -188,7 +193,7 @@ void test_list_insert_before_multithreaded(TestParams *params)
     for (int i = 1; i <= params->num_threads; i++)
     {
         list_insert(&head, i * 10);    // Sequentially increasing data
-        nodes[i] = nodes[i - 1]->next; // Save pointer to the newly added node
+        nodes[i] = list_next(nodes[i - 1]); // Save pointer to the newly added node
     }
 
     pthread_t threads[params->num_threads];
@@ -469,13 +474,13 @@ void test_list_display()
 
     // Test case 2: Displaying list from second node to end
     memset(buffer, 0, sizeof(buffer)); // Clear buffer
-    capture_stdout(buffer, sizeof(buffer), (void (*)(Node **, Node *, Node *))list_display_range, &head, head->next, NULL);
+    capture_stdout(buffer, sizeof(buffer), (void (*)(Node **, Node *, Node *))list_display_range, &head, list_next(head), NULL);
     my_assert(strcmp(buffer, string2Last) == 0);
     printf("\tFrom second node to end: %s\n", buffer);
 
     // Test case 3: Displaying list from first node to third node
     memset(buffer, 0, sizeof(buffer)); // Clear buffer
-    capture_stdout(buffer, sizeof(buffer), (void (*)(Node **, Node *, Node *))list_display_range, &head, head, head->next->next);
+    capture_stdout(buffer, sizeof(buffer), (void (*)(Node **, Node *, Node *))list_display_range, &head, head, list_next(list_next(head)));
     my_assert(strcmp(buffer, string1third) == 0);
     printf("\tFrom first node to third node: %s\n", buffer);
 
@@ -489,6 +494,45 @@ void test_list_display()
     printf_green("  ... [PASS].\n");
 }
 
+void test_list_display_buffered()
+{
+    printf_yellow("  Testing list_format_range and list_display_range_fd ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 5);
+    uint16_t values[] = {0, 7, 42, 999, 65535};
+    list_insert_bulk(&head, values, 5);
+    const char *expected = "[0, 7, 42, 999, 65535]";
+
+    char buffer[64];
+    my_assert(list_format_range(&head, NULL, NULL, buffer, sizeof(buffer)) == strlen(expected));
+    my_assert(strcmp(buffer, expected) == 0);
+
+    // Second to fourth node
+    list_format_range(&head, list_next(head), list_next(list_next(list_next(head))), buffer, sizeof(buffer));
+    my_assert(strcmp(buffer, "[7, 42, 999]") == 0);
+
+    // A short buffer is cut and terminated, the full length is still reported
+    char small[8];
+    my_assert(list_format_range(&head, NULL, NULL, small, sizeof(small)) == strlen(expected));
+    my_assert(strcmp(small, "[0, 7, ") == 0);
+
+    int fds[2];
+    my_assert(pipe(fds) == 0);
+    my_assert(list_display_range_fd(&head, NULL, NULL, fds[1]) == (ssize_t)strlen(expected));
+    memset(buffer, 0, sizeof(buffer));
+    my_assert(read(fds[0], buffer, sizeof(buffer)) == (ssize_t)strlen(expected));
+    my_assert(strcmp(buffer, expected) == 0);
+    close(fds[0]);
+    close(fds[1]);
+
+    list_cleanup(&head);
+    list_init(&head, sizeof(Node));
+    list_format_range(&head, NULL, NULL, buffer, sizeof(buffer));
+    my_assert(strcmp(buffer, "[]") == 0);
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
 void test_list_count_nodes()
 {
     printf_yellow("  Testing list_count_nodes ---> ");
@@ -535,7 +579,7 @@ void test_list_insert_loop(int count)
     for (int i = 0; i < count; i++)
     {
         my_assert(current->data == i);
-        current = current->next;
+        current = list_next(current);
     }
 
     list_cleanup(&head);
@@ -557,12 +601,12 @@ void test_list_insert_after_loop(int count)
 
     Node *current = head;
     my_assert(current->data == 12345);
-    current = current->next;
+    current = list_next(current);
 
     for (int i = count - 1; i >= 0; i--)
     {
         my_assert(current->data == i);
-        current = current->next;
+        current = list_next(current);
     }
 
     list_cleanup(&head);
@@ -610,6 +654,40 @@ void test_list_search_loop(int count)
     printf_green("[PASS].\n");
 }
 
+void test_list_insert_bulk(int count)
+{
+    printf_yellow("  Testing list_insert_bulk ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * (count + 1));
+    uint16_t *values = malloc(count * sizeof(uint16_t));
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = i;
+    }
+
+    list_insert(&head, 12345);
+    my_assert(list_insert_bulk(&head, values, count - 1) == (size_t)(count - 1));
+    my_assert(list_count_nodes(&head) == count);
+
+    Node *current = head;
+    my_assert(current->data == 12345);
+    current = list_next(current);
+    for (int i = 0; i < count - 1; i++)
+    {
+        my_assert(current->data == i);
+        current = list_next(current);
+    }
+    my_assert(current == NULL);
+
+    // Only one node left in the pool
+    my_assert(list_insert_bulk(&head, values, count) == 1);
+    my_assert(list_count_nodes(&head) == count + 1);
+
+    list_cleanup(&head);
+    free(values);
+    printf_green("[PASS].\n");
+}
+
 void test_list_edge_cases()
 {
     printf_yellow("  Testing list edge cases ---> ");
@@ -623,18 +701,18 @@ void test_list_edge_cases()
     // Insert after
     Node *node = list_search(&head, 10);
     list_insert_after(node, 20);
-    my_assert(node->next->data == 20);
+    my_assert(list_next(node)->data == 20);
 
     // Insert before
     list_insert_before(&head, node, 15);
 
     my_assert(head->data == 15);
-    my_assert(head->next->data == 10);
-    my_assert(head->next->next->data == 20);
+    my_assert(list_next(head)->data == 10);
+    my_assert(list_next(list_next(head))->data == 20);
 
     // Delete
     list_delete(&head, 15);
-    my_assert(node->next->data == 20);
+    my_assert(list_next(node)->data == 20);
 
     // Search
     Node *found = list_search(&head, 20);
@@ -644,6 +722,802 @@ void test_list_edge_cases()
     printf_green("[PASS].\n");
 }
 
+// ********* RCU read-mostly mode *********
+
+void test_list_rcu_basic()
+{
+    printf_yellow("  Testing RCU mode insert/search/delete ---> ");
+    Node *head = NULL;
+    // Room for the live nodes plus a full batch of nodes waiting for a grace period
+    list_init_sync(&head, sizeof(Node) * (4 + LIST_RCU_RETIRE_BATCH), LIST_SYNC_RCU);
+    list_insert(&head, 10);
+    list_insert(&head, 20);
+    list_insert_before(&head, head, 5);
+    list_insert_after(list_search(&head, 20), 30);
+    my_assert(list_count_nodes(&head) == 4);
+    my_assert(head->data == 5);
+    my_assert(list_next(list_next(list_next(head)))->data == 30);
+
+    list_delete(&head, 20);
+    my_assert(list_search(&head, 20) == NULL);
+    my_assert(list_count_nodes(&head) == 3);
+
+    // Churn through more deletions than fit in one retire batch so that
+    // reclamation has to give nodes back to the pool for the inserts to succeed
+    for (int i = 0; i < 4 * LIST_RCU_RETIRE_BATCH; i++)
+    {
+        list_insert(&head, 1000 + i);
+        list_delete(&head, 1000 + i);
+    }
+    my_assert(list_count_nodes(&head) == 3);
+
+    list_cleanup(&head);
+    my_assert(head == NULL);
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    Node **head;
+    int thread_id;
+    int num_ops;     // Number of operations to run
+    int num_nodes;   // Values 0..num_nodes-1 are in the list
+} read_mostly_data_t;
+
+void *thread_read_mostly_function(void *arg)
+{
+    read_mostly_data_t *data = (read_mostly_data_t *)arg;
+    unsigned int seed = data->thread_id + 1;
+    uint16_t own_value = 60000 + data->thread_id; // Never collides with the prefilled values
+    for (int i = 0; i < data->num_ops; i++)
+    {
+        int op = rand_r(&seed) % 100;
+        if (op < 90)
+        {
+            uint16_t value = rand_r(&seed) % data->num_nodes;
+            Node *found = list_search(data->head, value);
+            my_assert(found != NULL);
+        }
+        else if (op < 95)
+        {
+            list_count_nodes(data->head);
+        }
+        else
+        {
+            list_insert(data->head, own_value);
+            list_delete(data->head, own_value);
+        }
+    }
+    return NULL;
+}
+
+// 95% list_search/list_count_nodes and 5% insert+delete pairs, reports wall time
+void test_list_read_mostly(TestParams *params, list_sync_mode mode)
+{
+    printf_yellow("  Read-heavy benchmark (%s, threads: %d, nodes: %d) ---> ", list_sync_name(mode), params->num_threads, params->num_nodes);
+    Node *head = NULL;
+    list_init_sync(&head, sizeof(Node) * (params->num_nodes + params->num_threads + LIST_RCU_RETIRE_BATCH), mode);
+    uint16_t *values = malloc(params->num_nodes * sizeof(uint16_t));
+    for (int i = 0; i < params->num_nodes; i++)
+    {
+        values[i] = i;
+    }
+    list_insert_bulk(&head, values, params->num_nodes);
+    free(values);
+
+    pthread_t *threads = malloc(params->num_threads * sizeof(pthread_t));
+    read_mostly_data_t *thread_data = malloc(params->num_threads * sizeof(read_mostly_data_t));
+    int total_ops = 1 << 16;
+
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        thread_data[i].head = &head;
+        thread_data[i].thread_id = i;
+        thread_data[i].num_ops = total_ops / params->num_threads;
+        thread_data[i].num_nodes = params->num_nodes;
+        if (pthread_create(&threads[i], NULL, thread_read_mostly_function, &thread_data[i]))
+        {
+            perror("Failed to create thread");
+        }
+    }
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+
+    my_assert(list_count_nodes(&head) == params->num_nodes);
+    printf_yellow("Time: %ld microseconds.\t", micros);
+    printf_green("[PASS].\n");
+
+    list_cleanup(&head);
+    free(threads);
+    free(thread_data);
+}
+
+// ********* Independent List instances *********
+
+void test_list_handles_independent()
+{
+    printf_yellow("  Testing independent List instances ---> ");
+    List a, b;
+    list_h_init(&a, sizeof(Node) * 3, LIST_SYNC_RWLOCK);
+    list_h_init(&b, sizeof(Node) * 3, LIST_SYNC_RCU);
+    list_h_insert(&a, 1);
+    list_h_insert(&a, 2);
+    list_h_insert(&b, 10);
+    // Readers write to the lock in rwlock mode, writers to head, tail and count
+    my_assert((uintptr_t)&a.lock / MEM_CACHE_LINE != (uintptr_t)&a.head / MEM_CACHE_LINE);
+    my_assert((uintptr_t)&a.lock / MEM_CACHE_LINE != (uintptr_t)&a.pool / MEM_CACHE_LINE);
+    my_assert((uintptr_t)&a.count / MEM_CACHE_LINE == (uintptr_t)&a.head / MEM_CACHE_LINE);
+
+    // Setting up and tearing down the Node** list must not touch either instance
+    Node *head = NULL;
+    list_init(&head, sizeof(Node));
+    list_insert(&head, 99);
+    list_cleanup(&head);
+
+    list_h_insert(&a, 3);
+    list_h_insert_before(&b, b.head, 5);
+    list_h_insert_after(&b, b.tail, 20);
+    my_assert(list_h_count_nodes(&a) == 3);
+    my_assert(list_h_count_nodes(&b) == 3);
+    my_assert(a.head->data == 1 && a.tail->data == 3);
+    my_assert(b.head->data == 5 && b.tail->data == 20);
+    my_assert(list_h_search(&a, 10) == NULL);
+    my_assert(list_h_search(&b, 10) != NULL);
+
+    // Deleting the tail moves it back
+    list_h_delete(&a, 3);
+    my_assert(a.tail->data == 2);
+    list_h_insert(&a, 4);
+    my_assert(list_next(list_next(a.head))->data == 4);
+    my_assert(list_h_count_nodes(&a) == 3);
+
+    list_h_cleanup(&a);
+    my_assert(list_h_search(&b, 20) == b.tail);
+    list_h_cleanup(&b);
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    List *list;
+    int num_nodes;
+} list_handle_data_t;
+
+void *thread_list_handle_function(void *arg)
+{
+    list_handle_data_t *data = (list_handle_data_t *)arg;
+    for (int i = 0; i < data->num_nodes; i++)
+    {
+        list_h_insert(data->list, i);
+    }
+    for (int i = 0; i < data->num_nodes; i += 2)
+    {
+        list_h_delete(data->list, i);
+    }
+    return NULL;
+}
+
+// Each thread works on a List of its own, in parallel with the others
+void test_list_handles_multithread(TestParams *params)
+{
+    printf_yellow("  Testing List instances (threads: %d, nodes: %d) ---> ", params->num_threads, params->num_nodes);
+    List *lists = aligned_alloc(MEM_CACHE_LINE, params->num_threads * sizeof(List));
+    pthread_t *threads = malloc(params->num_threads * sizeof(pthread_t));
+    list_handle_data_t *thread_data = malloc(params->num_threads * sizeof(list_handle_data_t));
+    int nodes_per_thread = params->num_nodes / params->num_threads;
+
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        list_h_init(&lists[i], sizeof(Node) * nodes_per_thread, LIST_SYNC_RWLOCK);
+        thread_data[i].list = &lists[i];
+        thread_data[i].num_nodes = nodes_per_thread;
+        if (pthread_create(&threads[i], NULL, thread_list_handle_function, &thread_data[i]))
+        {
+            perror("Failed to create thread");
+        }
+    }
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        my_assert(list_h_count_nodes(&lists[i]) == nodes_per_thread / 2);
+        my_assert(list_h_search(&lists[i], 1) != NULL);
+        my_assert(list_h_search(&lists[i], 0) == NULL);
+        list_h_cleanup(&lists[i]);
+    }
+
+    free(lists);
+    free(threads);
+    free(thread_data);
+    printf_green("[PASS].\n");
+}
+
+// ********* Sharded list *********
+
+typedef struct
+{
+    ShardedList *list;
+    int start_value;
+    int num_nodes;
+} sharded_data_t;
+
+void *thread_sharded_function(void *arg)
+{
+    sharded_data_t *data = (sharded_data_t *)arg;
+    for (int i = 0; i < data->num_nodes; i++)
+    {
+        sharded_list_insert(data->list, data->start_value + i);
+    }
+    for (int i = 1; i < data->num_nodes; i += 2)
+    {
+        sharded_list_delete(data->list, data->start_value + i);
+    }
+    return NULL;
+}
+
+void test_sharded_list_multithread(TestParams *params, size_t num_shards)
+{
+    printf_yellow("  Testing sharded list (threads: %d, nodes: %d, shards: %zu) ---> ", params->num_threads, params->num_nodes, num_shards);
+    ShardedList list;
+    // Twice the even share per shard leaves room for an uneven hash spread
+    sharded_list_init(&list, num_shards, sizeof(Node) * (2 * params->num_nodes / num_shards + 16), LIST_SYNC_RWLOCK);
+
+    pthread_t *threads = malloc(params->num_threads * sizeof(pthread_t));
+    sharded_data_t *thread_data = malloc(params->num_threads * sizeof(sharded_data_t));
+    int nodes_per_thread = params->num_nodes / params->num_threads;
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        thread_data[i].list = &list;
+        thread_data[i].start_value = i * nodes_per_thread;
+        thread_data[i].num_nodes = nodes_per_thread;
+        if (pthread_create(&threads[i], NULL, thread_sharded_function, &thread_data[i]))
+        {
+            perror("Failed to create thread");
+        }
+    }
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    my_assert(sharded_list_count_nodes(&list) == (size_t)(params->num_threads * ((nodes_per_thread + 1) / 2)));
+    for (int i = 0; i < params->num_threads * nodes_per_thread; i++)
+    {
+        Node *found = sharded_list_search(&list, i);
+        if (i % nodes_per_thread % 2 == 0)
+            my_assert(found != NULL && found->data == i);
+        else
+            my_assert(found == NULL);
+    }
+
+    sharded_list_cleanup(&list);
+    free(threads);
+    free(thread_data);
+    printf_green("[PASS].\n");
+}
+
+// ********* Parallel traversal *********
+
+void test_list_parallel_scan(int count)
+{
+    printf_yellow("  Testing parallel search and aggregate (nodes: %d) ---> ", count);
+    worker_pool_start(3);
+    List list;
+    list_h_init(&list, sizeof(Node) * (count + 2), LIST_SYNC_RWLOCK);
+
+    list_aggregate empty = list_h_aggregate_parallel(&list);
+    my_assert(empty.count == 0 && empty.sum == 0);
+    my_assert(list_h_search_parallel(&list, 1) == NULL);
+
+    uint16_t *values = malloc(count * sizeof(uint16_t));
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = i + 1;
+        sum += values[i];
+    }
+    list_h_insert_bulk(&list, values, count / 2);
+    for (int i = count / 2; i < count; i++)
+    {
+        list_h_insert(&list, values[i]);
+    }
+    my_assert(list.mark_count == (size_t)((count - 1) / LIST_SEGMENT_NODES));
+
+    // Delete the nodes that start segments, their successors take over
+    for (size_t i = 0; i < list.mark_count; i++)
+    {
+        Node *mark = list.marks[i];
+        Node *successor = list_next(mark);
+        sum -= mark->data;
+        list_h_delete(&list, mark->data);
+        my_assert(list.marks[i] == successor);
+    }
+    list_h_insert_after(&list, list.head, 0);
+    list_h_insert(&list, 60000);
+    list_h_insert(&list, 7);
+    sum += 60000 + 7;
+
+    list_aggregate total = list_h_aggregate_parallel(&list);
+    my_assert(total.count == list_h_count_nodes(&list));
+    my_assert(total.sum == sum);
+    my_assert(total.min == 0);
+    my_assert(total.max == 60000);
+
+    // 7 is in the list twice, the first one wins
+    Node *found = list_h_search_parallel(&list, 7);
+    my_assert(found != NULL && found != list.tail && found == list_h_search(&list, 7));
+    my_assert(list_h_search_parallel(&list, count) == list_h_search(&list, count));
+    my_assert(list_h_search_parallel(&list, 60000) == list_h_search(&list, 60000));
+    my_assert(list_h_search_parallel(&list, 60001) == NULL);
+
+    list_h_cleanup(&list);
+    free(values);
+    worker_pool_stop();
+    printf_green("[PASS].\n");
+}
+
+void test_list_sorted_ops()
+{
+    printf_yellow("  Testing list_insert_sorted/list_merge/list_sort ---> ");
+    Node *a = NULL;
+    Node *b = NULL;
+    list_init(&a, sizeof(Node) * 16);
+    uint16_t a_values[] = {30, 10, 20, 10};
+    for (int i = 0; i < 4; i++)
+    {
+        list_insert_sorted(&a, a_values[i]);
+    }
+    my_assert(list_count_nodes(&a) == 4);
+    // The second 10 lands after the first one
+    Node *first_ten = a;
+    my_assert(first_ten->data == 10 && list_next(first_ten)->data == 10);
+
+    list_insert(&b, 25);
+    list_insert(&b, 5);
+    list_insert(&b, 10);
+    list_insert(&b, 40);
+    list_sort(&b);
+    uint16_t b_sorted[] = {5, 10, 25, 40};
+    Node *current = b;
+    for (int i = 0; i < 4; i++)
+    {
+        my_assert(current->data == b_sorted[i]);
+        current = list_next(current);
+    }
+    my_assert(current == NULL);
+    Node *b_ten = list_search(&b, 10);
+
+    list_merge(&a, &b);
+    my_assert(b == NULL);
+    uint16_t merged[] = {5, 10, 10, 10, 20, 25, 30, 40};
+    current = a;
+    for (int i = 0; i < 8; i++)
+    {
+        my_assert(current->data == merged[i]);
+        current = list_next(current);
+    }
+    my_assert(current == NULL);
+    // Ties keep the nodes of the first list first, no node was reallocated
+    my_assert(list_next(a) == first_ten);
+    my_assert(list_next(list_next(list_next(a))) == b_ten);
+
+    list_cleanup(&a);
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    List *list;
+    int stop;
+    size_t misses;
+} sort_reader_t;
+
+// Looks up a value that stays in the list the whole time
+static void *sort_reader(void *arg)
+{
+    sort_reader_t *reader = (sort_reader_t *)arg;
+    while (!__atomic_load_n(&reader->stop, __ATOMIC_ACQUIRE))
+    {
+        if (!list_h_search(reader->list, 1001))
+            reader->misses++;
+    }
+    return NULL;
+}
+
+void test_list_h_sort(int count, list_sync_mode mode)
+{
+    printf_yellow("  Testing list_h_sort (nodes: %d, %s) ---> ", count,
+                  list_sync_name(mode));
+    List list;
+    // RCU mode sorts a copy
+    list_h_init(&list, sizeof(Node) * (2 * count + 256), mode);
+    list_h_sort(&list);
+    my_assert(list.head == NULL && list.tail == NULL);
+
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        uint16_t value = rand() % 1000;
+        sum += value;
+        list_h_insert(&list, value);
+    }
+    list_h_sort(&list);
+
+    size_t seen = 0;
+    Node *last = NULL;
+    for (Node *current = list.head; current != NULL; current = list_next(current))
+    {
+        if (last)
+            my_assert(last->data <= current->data);
+        last = current;
+        seen++;
+    }
+    my_assert(seen == (size_t)count);
+    my_assert(list.tail == last);
+    my_assert(list.mark_count == (size_t)((count - 1) / LIST_SEGMENT_NODES));
+
+    // Appending past the maximum keeps the list sorted and the tail current
+    list_h_insert_sorted(&list, 1000);
+    my_assert(list.tail->data == 1000);
+    list_h_insert_sorted(&list, 0);
+    my_assert(list.head->data == 0);
+
+    list_aggregate total = list_h_aggregate_parallel(&list);
+    my_assert(total.count == (size_t)count + 2);
+    my_assert(total.sum == sum + 1000);
+    my_assert(total.min == 0 && total.max == 1000);
+
+    // Readers never find the list empty while it is being sorted
+    list_h_insert(&list, 1001);
+    sort_reader_t reader = {.list = &list};
+    pthread_t thread;
+    pthread_create(&thread, NULL, sort_reader, &reader);
+    for (int i = 0; i < 64; i++)
+    {
+        list_h_insert(&list, rand() % 1000);
+        list_h_sort(&list);
+    }
+    __atomic_store_n(&reader.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    my_assert(reader.misses == 0);
+    my_assert(list.tail->data == 1001);
+
+    list_h_cleanup(&list);
+    worker_pool_stop();
+    printf_green("[PASS].\n");
+}
+
+static void *iterator_writer(void *arg)
+{
+    list_h_insert((List *)arg, 4242);
+    return NULL;
+}
+
+void test_list_iterator(int count, list_sync_mode mode)
+{
+    printf_yellow("  Testing list iterator (nodes: %d, %s) ---> ", count,
+                  list_sync_name(mode));
+    List list;
+    list_h_init(&list, sizeof(Node) * (count + 1), mode);
+    list_iter it;
+    list_h_iter_begin(&it, &list);
+    my_assert(list_iter_next(&it) == NULL);
+    list_iter_end(&it);
+
+    for (int i = 0; i < count; i++)
+    {
+        list_h_insert(&list, i);
+    }
+
+    // Single steps and batches that do not divide the list evenly
+    list_h_iter_begin(&it, &list);
+    uint16_t batch[7];
+    int expected = 0;
+    Node *node = list_iter_next(&it);
+    my_assert(node == list.head && node->data == expected++);
+    size_t filled;
+    while ((filled = list_iter_next_batch(&it, batch, 7)) > 0)
+    {
+        for (size_t i = 0; i < filled; i++)
+        {
+            my_assert(batch[i] == expected++);
+        }
+        if (filled < 7)
+            break;
+    }
+    my_assert(expected == count);
+    my_assert(list_iter_next(&it) == NULL);
+    my_assert(list_iter_next_batch(&it, batch, 7) == 0);
+
+    // Lock-free readers do not hold back writers, appends may show up
+    if (mode == LIST_SYNC_RCU)
+    {
+        pthread_t writer;
+        pthread_create(&writer, NULL, iterator_writer, &list);
+        pthread_join(writer, NULL);
+    }
+    list_iter_end(&it);
+    my_assert(it.list == NULL);
+
+    list_h_cleanup(&list);
+    printf_green("[PASS].\n");
+}
+
+void test_list_iterator_legacy()
+{
+    printf_yellow("  Testing list_iter_begin on a Node** list ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 3);
+    list_insert(&head, 1);
+    list_insert(&head, 2);
+    list_insert(&head, 3);
+    list_iter it;
+    list_iter_begin(&it, &head);
+    uint16_t values[4];
+    my_assert(list_iter_next_batch(&it, values, 4) == 3);
+    my_assert(values[0] == 1 && values[1] == 2 && values[2] == 3);
+    list_iter_end(&it);
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
+static int in_range(uint16_t data, void *ctx)
+{
+    const uint16_t *range = ctx;
+    return data >= range[0] && data < range[1];
+}
+
+void test_list_delete_if(int count, list_sync_mode mode)
+{
+    printf_yellow("  Testing list_delete_if/list_delete_all (nodes: %d, %s) ---> ", count,
+                  list_sync_name(mode));
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 8);
+    list_insert(&head, 7);
+    list_insert(&head, 1);
+    list_insert(&head, 7);
+    list_insert(&head, 7);
+    list_insert(&head, 2);
+    list_insert(&head, 7);
+    my_assert(list_delete_all(&head, 7) == 4);
+    my_assert(list_delete_all(&head, 7) == 0);
+    my_assert(list_count_nodes(&head) == 2);
+    my_assert(head->data == 1 && list_next(head)->data == 2);
+    my_assert(list_delete_all(&head, 1) == 1 && list_delete_all(&head, 2) == 1);
+    my_assert(head == NULL);
+    list_cleanup(&head);
+
+    List list;
+    list_h_init(&list, sizeof(Node) * count, mode);
+    for (int i = 0; i < count; i++)
+    {
+        list_h_insert(&list, i % 100);
+    }
+    uint16_t range[] = {10, 60};
+    size_t removed = list_h_delete_if(&list, in_range, range);
+    my_assert(removed == (size_t)(count / 100 * 50));
+    my_assert(list_h_count_nodes(&list) == (size_t)count - removed);
+    my_assert(list_h_delete_all(&list, 99) == (size_t)(count / 100));
+
+    size_t seen = 0;
+    Node *last = NULL;
+    for (Node *current = list.head; current != NULL; current = list_next(current))
+    {
+        my_assert(current->data < 10 || (current->data >= 60 && current->data != 99));
+        last = current;
+        seen++;
+    }
+    my_assert(seen == list_h_count_nodes(&list));
+    my_assert(list.tail == last);
+    list_aggregate total = list_h_aggregate_parallel(&list);
+    my_assert(total.count == seen);
+
+    // The freed nodes are back in the pool and the list keeps working
+    for (size_t i = seen; i < (size_t)count; i++)
+    {
+        list_h_insert(&list, 500);
+    }
+    my_assert(list_h_count_nodes(&list) == (size_t)count && list.tail->data == 500);
+    list_h_cleanup(&list);
+    worker_pool_stop();
+    printf_green("[PASS].\n");
+}
+
+/// @brief Walks the list @p passes times
+/// @return microseconds taken
+static long time_traversal(List *list, int passes, uint64_t *sum)
+{
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int pass = 0; pass < passes; pass++)
+    {
+        for (Node *current = list->head; current != NULL; current = list_next(current))
+        {
+            *sum += current->data;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    return (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+void test_list_compact(int count, list_sync_mode mode)
+{
+    printf_yellow("  Testing list_h_compact (nodes: %d, %s) ---> ", count,
+                  list_sync_name(mode));
+    List list;
+    // Room for the copy RCU mode makes
+    list_h_init(&list, sizeof(Node) * 2 * count, mode);
+    my_assert(list_h_compact(&list) == 0);
+
+    // Sorted inserts of random values link the nodes in an order unrelated to
+    // their addresses, deleting and refilling leaves holes between them
+    for (int i = 0; i < count; i++)
+    {
+        list_h_insert_sorted(&list, rand() % 4096);
+    }
+    uint16_t range[] = {1000, 2000};
+    size_t removed = list_h_delete_if(&list, in_range, range);
+    for (size_t i = 0; i < removed / 2; i++)
+    {
+        list_h_insert_sorted(&list, rand() % 4096);
+    }
+    size_t n = list_h_count_nodes(&list);
+    uint16_t *before = malloc(n * sizeof(uint16_t));
+    list_iter it;
+    list_h_iter_begin(&it, &list);
+    my_assert(list_iter_next_batch(&it, before, n) == n);
+    list_iter_end(&it);
+
+    uint64_t sum_before = 0;
+    uint64_t sum_after = 0;
+    long scattered = time_traversal(&list, 64, &sum_before);
+    my_assert(list_h_compact(&list) == n);
+    long compacted = time_traversal(&list, 64, &sum_after);
+    my_assert(sum_before == sum_after);
+
+    size_t i = 0;
+    Node *last = NULL;
+    for (Node *current = list.head; current != NULL; current = list_next(current))
+    {
+        my_assert(current->data == before[i++]);
+        if (last)
+            my_assert(current > last);
+        // Nothing else lives in the pool, the nodes end up packed at its start
+        if (mode == LIST_SYNC_RWLOCK)
+            my_assert(current == (last ? last + 1 : (Node *)list.pool->memory));
+        last = current;
+    }
+    my_assert(i == n && list.tail == last);
+    my_assert(list_h_count_nodes(&list) == n);
+    my_assert(list.mark_count == (n - 1) / LIST_SEGMENT_NODES);
+
+    // The pool is still consistent
+    list_h_insert(&list, 9999);
+    my_assert(list.tail->data == 9999 && list_h_count_nodes(&list) == n + 1);
+    my_assert(list_h_delete_all(&list, 9999) == 1);
+
+    printf_yellow("Traversal: %ld -> %ld microseconds.\t", scattered, compacted);
+    list_h_cleanup(&list);
+    free(before);
+    printf_green("[PASS].\n");
+}
+
+void test_list_compact_legacy()
+{
+    printf_yellow("  Testing list_compact on a Node** list ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 4);
+    list_insert(&head, 1);
+    list_insert(&head, 2);
+    list_insert(&head, 3);
+    list_insert_before(&head, head, 0);
+    list_delete(&head, 2);
+    my_assert(list_compact(&head) == 3);
+    my_assert(head == mem_default_pool()->memory);
+    my_assert(head->data == 0 && list_next(head) == head + 1);
+    my_assert(list_next(head + 1) == head + 2 && (head + 2)->data == 3);
+    my_assert(list_next(head + 2) == NULL);
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    brlock *lock;
+    long *pair; // both halves only differ while a writer is in the lock
+    int iterations;
+    int write_every;
+} brlock_data_t;
+
+void *thread_brlock_function(void *arg)
+{
+    brlock_data_t *data = (brlock_data_t *)arg;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        if (i % data->write_every == 0)
+        {
+            brlock_write_lock(data->lock);
+            data->pair[0]++;
+            sched_yield();
+            data->pair[1]++;
+            brlock_write_unlock(data->lock);
+        }
+        else
+        {
+            brlock_read_lock(data->lock);
+            my_assert(*(volatile long *)&data->pair[0] == *(volatile long *)&data->pair[1]);
+            brlock_read_unlock(data->lock);
+        }
+    }
+    return NULL;
+}
+
+void *thread_brlock_writer(void *arg)
+{
+    brlock_write_lock((brlock *)arg);
+    brlock_write_unlock((brlock *)arg);
+    return NULL;
+}
+
+void test_brlock(int num_threads)
+{
+    printf_yellow("  Testing brlock (threads: %d) ---> ", num_threads);
+    brlock lock;
+    my_assert(brlock_init(&lock) == 0);
+    long pair[2] = {0, 0};
+    pthread_t threads[num_threads];
+    brlock_data_t data = {.lock = &lock, .pair = pair, .iterations = 1 << 12, .write_every = 64};
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_create(&threads[i], NULL, thread_brlock_function, &data);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    my_assert(pair[0] == (long)num_threads * (data.iterations / data.write_every));
+    my_assert(pair[1] == pair[0]);
+
+    // Taking the read side again while a writer waits must not deadlock
+    pthread_t writer;
+    brlock_read_lock(&lock);
+    pthread_create(&writer, NULL, thread_brlock_writer, &lock);
+    while (!__atomic_load_n(&lock.writer, __ATOMIC_SEQ_CST))
+        sched_yield();
+    brlock_read_lock(&lock);
+    brlock_read_unlock(&lock);
+    brlock_read_unlock(&lock);
+    pthread_join(writer, NULL);
+
+    // Reading one lock more than the held table records must abort, not
+    // silently lose track of the section
+    pid_t child = fork();
+    if (child == 0) {
+        brlock locks[BRLOCK_MAX_NESTED + 1];
+        freopen("/dev/null", "w", stderr);
+        for (int i = 0; i <= BRLOCK_MAX_NESTED; i++) {
+            brlock_init(&locks[i]);
+            brlock_read_lock(&locks[i]);
+        }
+        _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+    my_assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+
+    brlock_destroy(&lock);
+    printf_green("[PASS].\n");
+}
+
 // Main function to run all tests
 int main(int argc, char *argv[])
 {
@@ -670,6 +1544,7 @@ int main(int argc, char *argv[])
         printf(" 6. test_list_insert_after - Test multiple insertions after a given node\n");
         printf(" 7. test_list_insert_after - Test multiple insertions after a given node\n");
         printf(" 8. test_list_delete - Test multiple detelions\n");
+        printf(" 9. test_list_read_mostly - Read-heavy benchmark, rwlock vs RCU vs ticket vs adaptive vs brlock mode\n");
         printf(" 0. Run all tests\n");
         return 1;
     }
@@ -685,6 +1560,33 @@ int main(int argc, char *argv[])
         test_list_insert_after_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
         test_list_insert_before_multithreaded(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
         test_list_delete_multithreaded(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
+        test_list_insert_bulk(1024);
+        test_list_display_buffered();
+        test_list_rcu_basic();
+        test_list_handles_independent();
+        test_list_handles_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
+        test_sharded_list_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024}, 16);
+        test_list_parallel_scan(1 << 14);
+        test_list_sorted_ops();
+        test_list_h_sort(1 << 12, LIST_SYNC_RWLOCK);
+        test_list_h_sort(1 << 12, LIST_SYNC_RCU);
+        test_list_iterator_legacy();
+        test_list_iterator(1000, LIST_SYNC_RWLOCK);
+        test_list_iterator(1000, LIST_SYNC_RCU);
+        test_list_delete_if(4000, LIST_SYNC_RWLOCK);
+        test_list_delete_if(4000, LIST_SYNC_RCU);
+        test_list_delete_if(4000, LIST_SYNC_TICKET);
+        test_list_iterator(1000, LIST_SYNC_ADAPTIVE);
+        test_list_iterator(1000, LIST_SYNC_BRLOCK);
+        test_brlock(base_num_threads);
+        test_list_compact_legacy();
+        test_list_compact(1 << 14, LIST_SYNC_RWLOCK);
+        test_list_compact(1 << 14, LIST_SYNC_RCU);
+        test_list_read_mostly(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024}, LIST_SYNC_RWLOCK);
+        test_list_read_mostly(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024}, LIST_SYNC_RCU);
+        test_list_read_mostly(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024}, LIST_SYNC_TICKET);
+        test_list_read_mostly(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024}, LIST_SYNC_ADAPTIVE);
+        test_list_read_mostly(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024}, LIST_SYNC_BRLOCK);
 
         printf("\nStress testing basic operations with various numbers of threads and nodes:\n");
         clock_t timer = clock();
@@ -731,6 +1633,13 @@ int main(int argc, char *argv[])
             for (int j = 8; j < 14; j++) // from 2^8 = 256 up to 2^14 = 16384 nodes
                 test_list_delete_multithreaded(&(TestParams){.num_threads = pow(2, i), .num_nodes = pow(2, j)});
         break;
+    case 9:
+        for (int i = 0; i < 9; i++) // from 2^0 = 1 up to 2^8 = 256 threads
+        {
+            for (list_sync_mode mode = LIST_SYNC_RWLOCK; mode <= LIST_SYNC_BRLOCK; mode++)
+                test_list_read_mostly(&(TestParams){.num_threads = pow(2, i), .num_nodes = 1024}, mode);
+        }
+        break;
 
     default:
         printf("Invalid test function\n");
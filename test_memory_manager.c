@@ -772,6 +772,414 @@ void test_memory_fragmentation_multithread(TestParams params)
     printf_green("[PASS].\n");
 }
 
+void *thread_alloc_many(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    void **blocks = malloc(data->num_blocks * sizeof(void *));
+    size_t allocated = mem_alloc_many(data->block_size, data->num_blocks, blocks);
+    my_assert(allocated == (size_t)data->num_blocks);
+    for (size_t i = 0; i < allocated; i++)
+        memset(blocks[i], data->thread_id, data->block_size);
+    for (size_t i = 0; i < allocated; i++)
+    {
+        sanityCheck(data->block_size, blocks[i], (char)data->thread_id);
+        mem_free(blocks[i]);
+    }
+    free(blocks);
+    return NULL;
+}
+
+void test_alloc_many_multithread(TestParams params)
+{
+    printf_yellow("  Testing \"mem_alloc_many\" (threads: %d, blocks: %d, block size: %zu) ---> ", params.num_threads, params.num_blocks, params.block_size);
+
+    // Batches fill gaps first-fit, in address order, like single allocations
+    mem_init(8 * params.block_size);
+    char *a = mem_alloc(params.block_size);
+    char *b = mem_alloc(params.block_size);
+    char *c = mem_alloc(params.block_size);
+    mem_free(b);
+    void *batch[3];
+    my_assert(mem_alloc_many(params.block_size, 3, batch) == 3);
+    my_assert(batch[0] == b);
+    my_assert(batch[1] == c + params.block_size);
+    my_assert(batch[2] == c + 2 * params.block_size);
+    // Only 3 blocks left, the batch is cut short
+    void *rest[4];
+    my_assert(mem_alloc_many(params.block_size, 4, rest) == 3);
+    my_assert(mem_alloc(params.block_size) == NULL);
+    mem_free(a);
+    mem_deinit();
+
+    pthread_t threads[params.num_threads];
+    thread_data_t params_t[params.num_threads];
+    mem_init(params.num_blocks * params.block_size);
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        params_t[i].thread_id = i;
+        params_t[i].block_size = params.block_size;
+        params_t[i].num_blocks = params.num_blocks / params.num_threads;
+        pthread_create(&threads[i], NULL, thread_alloc_many, &params_t[i]);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void *thread_free_many(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    void **blocks = malloc((data->num_blocks + 1) * sizeof(void *));
+    my_assert(mem_alloc_many(data->block_size, data->num_blocks, blocks) == (size_t)data->num_blocks);
+    // Out of order, with a pointer that was never allocated
+    for (int i = data->num_blocks - 1; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        void *temp = blocks[i];
+        blocks[i] = blocks[j];
+        blocks[j] = temp;
+    }
+    blocks[data->num_blocks] = (char *)blocks[0] + 1;
+    mem_free_many(blocks, data->num_blocks + 1);
+    free(blocks);
+    return NULL;
+}
+
+void test_free_many_multithread(TestParams params)
+{
+    printf_yellow("  Testing \"mem_free_many\" (threads: %d, blocks: %d, block size: %zu) ---> ", params.num_threads, params.num_blocks, params.block_size);
+
+    mem_init(4 * params.block_size);
+    char *a = mem_alloc(params.block_size);
+    char *b = mem_alloc(params.block_size);
+    char *c = mem_alloc(params.block_size);
+    void *some[] = {c, a};
+    mem_free_many(some, 2);
+    my_assert(some[0] == a && some[1] == c);
+    my_assert(mem_alloc(params.block_size) == a);
+    my_assert(mem_alloc(2 * params.block_size) == c);
+    mem_free_many(NULL, 0);
+    mem_free(a);
+    mem_free(b);
+    mem_free(c);
+    mem_deinit();
+
+    pthread_t threads[params.num_threads];
+    thread_data_t params_t[params.num_threads];
+    mem_init(params.num_blocks * params.block_size);
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        params_t[i].thread_id = i;
+        params_t[i].block_size = params.block_size;
+        params_t[i].num_blocks = params.num_blocks / params.num_threads;
+        pthread_create(&threads[i], NULL, thread_free_many, &params_t[i]);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    // Everything was given back
+    void *all = mem_alloc(params.num_blocks * params.block_size);
+    my_assert(all != NULL);
+    mem_free(all);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_repack()
+{
+    printf_yellow("  Testing \"mem_repack\" ---> ");
+    mem_init(8 * 64);
+    void *blocks[8];
+    my_assert(mem_alloc_many(64, 8, blocks) == 8);
+    // Keep 1, 4 and 6, another allocation stays at 3
+    mem_free(blocks[0]);
+    mem_free(blocks[2]);
+    mem_free(blocks[5]);
+    mem_free(blocks[7]);
+    void *other = blocks[3];
+    void *keep[] = {blocks[6], blocks[1], blocks[4]};
+    void *start = blocks[0];
+    my_assert(mem_repack(keep, 3, 64) == 3);
+    my_assert(keep[0] == start);
+    my_assert(keep[1] == (char *)start + 64);
+    my_assert(keep[2] == (char *)start + 2 * 64);
+    // The gap after the other block takes a 4 block allocation
+    my_assert(mem_alloc(4 * 64) == (char *)other + 64);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    mem_pool *pool;
+    int iterations;
+    size_t failures;  // written once at the end, the loops count locally
+} __attribute__((aligned(MEM_CACHE_LINE))) layout_data_t;
+
+void *thread_alloc_churn(void *arg)
+{
+    layout_data_t *data = (layout_data_t *)arg;
+    size_t failures = 0;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        void *block = mem_pool_alloc(data->pool, 16);
+        if (!block)
+            failures++;
+        mem_pool_free(data->pool, block);
+    }
+    data->failures = failures;
+    return NULL;
+}
+
+void *thread_oversized_alloc(void *arg)
+{
+    layout_data_t *data = (layout_data_t *)arg;
+    size_t failures = 0;
+    // Rejected by the size check mem_pool_alloc does before it takes the
+    // lock, which only reads the read-only line of the pool
+    for (int i = 0; i < data->iterations; i++)
+    {
+        if (!mem_pool_alloc(data->pool, data->pool->size + 1 + i % 64))
+            failures++;
+    }
+    data->failures = failures;
+    return NULL;
+}
+
+/// @brief Half the threads allocate and free blocks of @p pool, taking its
+/// lock, while the others make requests too large for it
+/// @return microseconds taken
+long time_layout(mem_pool *pool, int num_threads, int iterations)
+{
+    pthread_t threads[num_threads];
+    layout_data_t data[num_threads];
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int i = 0; i < num_threads; i++)
+    {
+        data[i] = (layout_data_t){.pool = pool, .iterations = iterations};
+        pthread_create(&threads[i], NULL, (i % 2) ? thread_oversized_alloc : thread_alloc_churn, &data[i]);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+        my_assert(data[i].failures == ((i % 2) ? (size_t)iterations : 0));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    return (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+void test_pool_layout_benchmark(TestParams params)
+{
+    printf_yellow("  Testing mem_pool cache line layout (threads: %d) ---> ", params.num_threads);
+    mem_pool pool;
+    mem_pool_init(&pool, params.memory_size);
+    my_assert((uintptr_t)&pool % MEM_CACHE_LINE == 0);
+    my_assert((uintptr_t)&pool.allocation_lock / MEM_CACHE_LINE != (uintptr_t)&pool.size / MEM_CACHE_LINE);
+    my_assert((uintptr_t)&pool.allocation_lock / MEM_CACHE_LINE != (uintptr_t)&pool.memory / MEM_CACHE_LINE);
+
+    long elapsed = time_layout(&pool, params.num_threads, params.iterations);
+    mem_pool_deinit(&pool);
+    printf_yellow("Time: %ld microseconds.\t", elapsed);
+    printf_green("[PASS].\n");
+}
+
+void test_pool_init_node(TestParams params)
+{
+    printf_yellow("  Testing \"mem_pool_init_node\" (mem_size: %zu) ---> ", params.memory_size);
+    mem_pool pool;
+    my_assert(mem_pool_init_node(&pool, params.memory_size, -1) == -1);
+    my_assert(pool.memory != NULL && !pool.mapped);
+    mem_pool_deinit(&pool);
+
+    // Node 0 always exists, binding can still fail without NUMA support
+    int bound = mem_pool_init_node(&pool, params.memory_size, 0);
+    my_assert(pool.mapped);
+    char *block = mem_pool_alloc(&pool, params.memory_size / 2);
+    my_assert(block == pool.memory);
+    memset(block, 0x5a, params.memory_size / 2);
+    sanityCheck(params.memory_size / 2, block, 0x5a);
+    my_assert(mem_pool_alloc(&pool, params.memory_size) == NULL);
+    mem_pool_free(&pool, block);
+    mem_pool_deinit(&pool);
+    printf_yellow("%s.\t", bound == 0 ? "Bound to node 0" : "No NUMA policy");
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    mem_lock *lock;
+    int iterations;
+    long *counter;
+} lock_data_t;
+
+void *thread_lock_increment(void *arg)
+{
+    lock_data_t *data = (lock_data_t *)arg;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        mem_lock_acquire(data->lock);
+        // Not atomic, lost updates show up if the lock lets two threads in
+        long value = *(volatile long *)data->counter;
+        *(volatile long *)data->counter = value + 1;
+        mem_lock_release(data->lock);
+    }
+    return NULL;
+}
+
+void test_mem_lock(TestParams params, mem_lock_kind kind)
+{
+    printf_yellow("  Testing \"mem_lock\" (%s, threads: %d) ---> ", mem_lock_name(kind), params.num_threads);
+    mem_lock lock;
+    mem_lock_init(&lock, kind);
+    long counter = 0;
+    pthread_t threads[params.num_threads];
+    lock_data_t data = {.lock = &lock, .iterations = params.iterations, .counter = &counter};
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_create(&threads[i], NULL, thread_lock_increment, &data);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    my_assert(counter == (long)params.num_threads * params.iterations);
+    mem_lock_destroy(&lock);
+    printf_green("[PASS].\n");
+}
+
+void *thread_short_alloc_free(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        void *block = mem_alloc(data->block_size);
+        my_assert(block != NULL);
+        mem_free(block);
+    }
+    return NULL;
+}
+
+/// @brief Times short alloc/free pairs on a pool whose allocation lock is of
+/// @p kind, the critical section is a head insertion and removal
+void test_lock_benchmark(TestParams params, mem_lock_kind kind)
+{
+    printf_yellow("  Allocation lock benchmark (%s, threads: %d) ---> ", mem_lock_name(kind), params.num_threads);
+    mem_init_lock(params.num_threads * params.block_size, kind);
+    pthread_t threads[params.num_threads];
+    thread_data_t data[params.num_threads];
+    struct timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        data[i].block_size = params.block_size;
+        data[i].iterations = params.iterations / params.num_threads;
+        pthread_create(&threads[i], NULL, thread_short_alloc_free, &data[i]);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+    mem_deinit();
+    printf_yellow("Time: %ld microseconds.\t", micros);
+    printf_green("[PASS].\n");
+}
+
+typedef struct
+{
+    size_t offset;
+    size_t size;
+} model_block_t;
+
+static int compare_model_blocks(const void *a, const void *b)
+{
+    const model_block_t *x = a, *y = b;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+/// @brief First-fit offset of @p size bytes among @p live blocks, -1 if none
+/// fits. Sorts @p live and reports the largest gap.
+static long model_first_fit(model_block_t *live, int count, size_t memory_size, size_t size, size_t *largest)
+{
+    qsort(live, count, sizeof(model_block_t), compare_model_blocks);
+    long fit = -1;
+    size_t gap_start = 0;
+    *largest = 0;
+    for (int i = 0; i <= count; i++)
+    {
+        size_t gap_end = i < count ? live[i].offset : memory_size;
+        size_t gap = gap_end - gap_start;
+        if (gap > *largest)
+            *largest = gap;
+        if (fit < 0 && gap >= size)
+            fit = gap_start;
+        if (i < count)
+            gap_start = live[i].offset + live[i].size;
+    }
+    return fit;
+}
+
+void test_free_range_index(size_t memory_size, int operations)
+{
+    printf_yellow("  Testing free range index against a model (mem_size: %zu, operations: %d) ---> ", memory_size, operations);
+    mem_init(memory_size);
+    my_assert(mem_largest_free() == memory_size);
+    char *base = mem_alloc(1);
+    mem_free(base);
+    model_block_t live[64];
+    int count = 0;
+    size_t largest;
+    for (int op = 0; op < operations; op++)
+    {
+        int kind = rand() % 3;
+        size_t size = 1 + rand() % (memory_size / 8);
+        if (kind == 0 && count < 64)
+        {
+            long expected = model_first_fit(live, count, memory_size, size, &largest);
+            char *block = mem_alloc(size);
+            my_assert(expected < 0 ? block == NULL : block == base + expected);
+            if (block)
+                live[count++] = (model_block_t){.offset = block - base, .size = size};
+        }
+        else if (kind == 1 && count > 0)
+        {
+            int victim = rand() % count;
+            mem_free(base + live[victim].offset);
+            live[victim] = live[--count];
+        }
+        else if (count > 0)
+        {
+            int victim = rand() % count;
+            model_block_t old = live[victim];
+            live[victim] = live[--count];
+            long expected = model_first_fit(live, count, memory_size, size, &largest);
+            char *block = mem_resize(base + old.offset, size);
+            if (expected < 0)
+            {
+                my_assert(block == NULL);
+                live[count++] = old;
+            }
+            else
+            {
+                my_assert(block == base + expected);
+                live[count++] = (model_block_t){.offset = expected, .size = size};
+            }
+        }
+        model_first_fit(live, count, memory_size, 1, &largest);
+        my_assert(mem_largest_free() == largest);
+    }
+    // An allocation larger than every gap fails without walking the blocks
+    my_assert(mem_alloc(largest + 1) == NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
 void *thread_function(void *arg)
 {
     thread_data_t *params = (thread_data_t *)arg;
@@ -902,7 +1310,8 @@ int main(int argc, char *argv[])
         printf("  0. tests various functions with a base number of threads\n");
         printf("  1. tests various functions across variious configurations (number of threads, memory sizes,  iterations)\n");
         printf("  2. stress tests various functions with various configurations. This may take some time (especially if simulate_work flag is set to true.\n");
-	printf("  3. test_looking_for_out_of_bounds, needs LD_PRELOAD=./libmymalloc.so .\n\n");
+	printf("  3. test_looking_for_out_of_bounds, needs LD_PRELOAD=./libmymalloc.so .\n");
+        printf("  4. compares the mutex, ticket and adaptive allocation locks from 1 to 256 threads\n\n");
         return 1;
     }
 
@@ -935,6 +1344,17 @@ int main(int argc, char *argv[])
 
         test_memory_fragmentation_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 2048});
         test_random_blocks_multithread((TestParams){.num_threads = base_num_threads, .block_size = 1024});
+        test_alloc_many_multithread((TestParams){.num_threads = base_num_threads, .num_blocks = 1024, .block_size = 64});
+        test_free_many_multithread((TestParams){.num_threads = base_num_threads, .num_blocks = 1024, .block_size = 64});
+        test_repack();
+        test_free_range_index(4096, 20000);
+        test_pool_layout_benchmark((TestParams){.num_threads = base_num_threads, .memory_size = 1024, .iterations = 1 << 16});
+        test_pool_init_node((TestParams){.memory_size = 1 << 20});
+        for (mem_lock_kind kind = MEM_LOCK_MUTEX; kind <= MEM_LOCK_ADAPTIVE; kind++)
+        {
+            test_mem_lock((TestParams){.num_threads = base_num_threads, .iterations = 1 << 16}, kind);
+            test_lock_benchmark((TestParams){.num_threads = base_num_threads, .block_size = 64, .iterations = 1 << 16}, kind);
+        }
 
         break;
 
@@ -985,6 +1405,13 @@ int main(int argc, char *argv[])
       test_looking_for_out_of_bounds();
       break;
 
+    case 4:
+        printf("\n*** Allocation lock comparison: ***\n");
+        for (int i = 0; i < 9; i++) // from 2^0 = 1 up to 2^8 = 256 threads
+            for (mem_lock_kind kind = MEM_LOCK_MUTEX; kind <= MEM_LOCK_ADAPTIVE; kind++)
+                test_lock_benchmark((TestParams){.num_threads = pow(2, i), .block_size = 64, .iterations = 1 << 16}, kind);
+        break;
+
     default:
         printf("Invalid test function\n");
         break;
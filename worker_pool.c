@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+#include "worker_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    worker_task task;
+    void *arg;
+    size_t n;
+    size_t next;  // next index to hand out
+    size_t done;  // indices finished
+} worker_job;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;      // a new job was posted or the pool is stopping
+    pthread_cond_t finished;  // the current job may have completed
+    pthread_mutex_t run_lock;  // one job at a time
+    pthread_t *threads;
+    size_t workers;
+    bool started;
+    bool stopping;
+    unsigned long generation;  // bumped for every posted job
+    worker_job *job;
+    size_t active;  // workers currently working on job
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .finished = PTHREAD_COND_INITIALIZER,
+    .run_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/// @brief Takes indices of @p job until none are left
+static void work_on(worker_job *job) {
+    for (;;) {
+        size_t index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->n) return;
+        job->task(job->arg, index);
+        if (__atomic_add_fetch(&job->done, 1, __ATOMIC_ACQ_REL) == job->n) {
+            pthread_mutex_lock(&pool.lock);
+            pthread_cond_broadcast(&pool.finished);
+            pthread_mutex_unlock(&pool.lock);
+        }
+    }
+}
+
+static void *worker_main(void *unused) {
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.generation == seen && !pool.stopping)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        if (pool.stopping) break;
+        seen = pool.generation;
+        worker_job *job = pool.job;
+        if (!job) continue;  // woke up after the job was already finished
+        pool.active++;
+        pthread_mutex_unlock(&pool.lock);
+        work_on(job);
+        pthread_mutex_lock(&pool.lock);
+        pool.active--;
+        pthread_cond_broadcast(&pool.finished);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+/// @brief Starts @p workers background threads. Called automatically with one
+/// worker per additional online CPU on first use if not called before.
+/// @param workers number of threads besides the caller of worker_pool_run
+void worker_pool_start(size_t workers) {
+    pthread_mutex_lock(&pool.run_lock);
+    pthread_mutex_lock(&pool.lock);
+    if (pool.started) {
+        pthread_mutex_unlock(&pool.lock);
+        pthread_mutex_unlock(&pool.run_lock);
+        return;
+    }
+    __atomic_store_n(&pool.started, true, __ATOMIC_RELEASE);
+    pool.stopping = false;
+    pool.threads = malloc(workers * sizeof(pthread_t));
+    pool.workers = 0;
+    for (size_t i = 0; pool.threads && i < workers; i++) {
+        if (pthread_create(&pool.threads[i], NULL, worker_main, NULL) != 0)
+            break;
+        pool.workers++;
+    }
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.run_lock);
+}
+
+/// @brief Runs @p task for every index in [0, @p n) on the workers and the
+/// calling thread, returns once all of them have finished
+/// @param n number of indices
+/// @param task called as task(arg, index)
+/// @param arg passed to every call
+void worker_pool_run(size_t n, worker_task task, void *arg) {
+    if (n == 0) return;
+    if (!__atomic_load_n(&pool.started, __ATOMIC_ACQUIRE)) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_pool_start(cpus > 1 ? cpus - 1 : 0);
+    }
+    worker_job job = {.task = task, .arg = arg, .n = n};
+    pthread_mutex_lock(&pool.run_lock);
+    if (pool.workers > 0 && n > 1) {
+        pthread_mutex_lock(&pool.lock);
+        pool.job = &job;
+        pool.generation++;
+        pthread_cond_broadcast(&pool.wake);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    work_on(&job);
+    pthread_mutex_lock(&pool.lock);
+    // Workers may still hold a pointer to the job, which lives on our stack
+    while (__atomic_load_n(&job.done, __ATOMIC_ACQUIRE) < n || pool.active > 0)
+        pthread_cond_wait(&pool.finished, &pool.lock);
+    pool.job = NULL;
+    pthread_mutex_unlock(&pool.lock);
+    pthread_mutex_unlock(&pool.run_lock);
+}
+
+/// @brief Stops and joins the workers, the next job starts them again
+void worker_pool_stop(void) {
+    pthread_mutex_lock(&pool.run_lock);
+    pthread_mutex_lock(&pool.lock);
+    pool.stopping = true;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+    for (size_t i = 0; i < pool.workers; i++) pthread_join(pool.threads[i], NULL);
+    free(pool.threads);
+    pool.threads = NULL;
+    pool.workers = 0;
+    __atomic_store_n(&pool.started, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&pool.run_lock);
+}
@@ -0,0 +1,22 @@
+// worker_pool.h
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stddef.h>
+
+/// @brief One unit of work, called once for every index of a job
+typedef void (*worker_task)(void *arg, size_t index);
+
+/// @brief Starts @p workers background threads. Called automatically with one
+/// worker per additional online CPU on first use if not called before.
+void worker_pool_start(size_t workers);
+
+/// @brief Runs @p task for every index in [0, @p n) on the workers and the
+/// calling thread, returns once all of them have finished. Jobs from
+/// different threads run one after the other.
+void worker_pool_run(size_t n, worker_task task, void *arg);
+
+/// @brief Stops and joins the workers
+void worker_pool_stop(void);
+
+#endif  // WORKER_POOL_H